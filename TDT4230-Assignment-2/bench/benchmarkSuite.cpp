@@ -0,0 +1,78 @@
+#include "benchmarkSuite.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+
+volatile const void *benchmarkSink;
+
+BenchmarkResult BenchmarkSuite::summarise(std::string const &name, std::vector<double> &samples, unsigned long long runsPerSample) {
+    std::sort(samples.begin(), samples.end());
+
+    double mean = 0;
+    for (double sample : samples) mean += sample;
+    mean /= samples.size();
+
+    double variance = 0;
+    for (double sample : samples) variance += (sample - mean) * (sample - mean);
+    variance /= std::max<size_t>(samples.size() - 1, 1);
+
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = samples.size() * runsPerSample;
+    result.meanNs = mean;
+    result.medianNs = samples.size() % 2 == 1
+        ? samples[samples.size() / 2]
+        : 0.5 * (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]);
+    result.minNs = samples.front();
+    result.stddevNs = std::sqrt(variance);
+    return result;
+}
+
+void BenchmarkSuite::report(BenchmarkResult const &result) {
+    std::string throughput;
+    if (result.itemsPerRun > 0) {
+        throughput = fmt::format("  {:.3g} {}/s", result.itemsPerRun / (result.medianNs * 1e-9), result.itemName);
+    }
+    std::cerr << fmt::format("{:<48} {:>12.1f} ns  ±{:>5.1f}%  {:>6} allocs  {:>8} KiB peak{}",
+                             result.name, result.medianNs, 100.0 * result.stddevNs / result.meanNs,
+                             result.allocations, result.peakBytes / 1024, throughput) << std::endl;
+}
+
+const BenchmarkResult *BenchmarkSuite::result(std::string const &name) const {
+    for (const BenchmarkResult &result : mResults) {
+        if (result.name == name) {
+            return &result;
+        }
+    }
+    return nullptr;
+}
+
+void BenchmarkSuite::fail(std::string const &message) {
+    std::cerr << "FAILED: " << message << std::endl;
+    mFailed = true;
+}
+
+void BenchmarkSuite::writeJSON(std::ostream &out) const {
+    out << "{\n";
+    out << fmt::format("    \"allocation_tracking\": {},\n", allocationTrackingAvailable() ? "true" : "false");
+    out << "    \"benchmarks\": [";
+    for (size_t i = 0; i < mResults.size(); i++) {
+        const BenchmarkResult &result = mResults[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "        {\n";
+        out << fmt::format("            \"name\": \"{}\",\n", result.name);
+        out << fmt::format("            \"iterations\": {},\n", result.iterations);
+        out << fmt::format("            \"mean_ns\": {:.2f},\n", result.meanNs);
+        out << fmt::format("            \"median_ns\": {:.2f},\n", result.medianNs);
+        out << fmt::format("            \"min_ns\": {:.2f},\n", result.minNs);
+        out << fmt::format("            \"stddev_ns\": {:.2f},\n", result.stddevNs);
+        if (result.itemsPerRun > 0) {
+            out << fmt::format("            \"{}_per_second\": {:.2f},\n", result.itemName, result.itemsPerRun / (result.medianNs * 1e-9));
+        }
+        out << fmt::format("            \"allocations\": {},\n", result.allocations);
+        out << fmt::format("            \"allocated_bytes\": {},\n", result.allocatedBytes);
+        out << fmt::format("            \"peak_bytes\": {}\n", result.peakBytes);
+        out << "        }";
+    }
+    out << "\n    ]\n}\n";
+}
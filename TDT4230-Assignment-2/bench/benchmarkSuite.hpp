@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utilities/allocationTracker.h>
+
+struct BenchmarkResult {
+    std::string name;
+    unsigned long long iterations;
+    double meanNs;
+    double medianNs;
+    double minNs;
+    double stddevNs;
+    // Heap allocations made by a single run of the benchmarked code
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+    // Most heap memory in use at once during that run, above what was in use before it
+    unsigned long long peakBytes;
+    // Optional throughput, e.g. vertices or bytes handled per run
+    double itemsPerRun;
+    std::string itemName;
+};
+
+// Keeps the result of a benchmarked call alive, so the call cannot be optimised away
+extern volatile const void *benchmarkSink;
+
+template <class T>
+inline void doNotOptimize(T const &value) {
+    benchmarkSink = &value;
+}
+
+class BenchmarkSuite {
+public:
+    BenchmarkSuite(std::string const &filter, double minSeconds)
+        : mFilter(filter), mMinSeconds(minSeconds) {}
+
+    // Times body() repeatedly until at least minSeconds have passed.
+    // itemsPerRun/itemName optionally describe how much work one run does.
+    // True if the filter selects the named benchmark, to skip expensive setup
+    bool matches(std::string const &name) const {
+        return mFilter.empty() || name.find(mFilter) != std::string::npos;
+    }
+
+    template <class Body>
+    void run(std::string const &name, Body body, double itemsPerRun = 0, std::string const &itemName = "") {
+        if (!matches(name)) {
+            return;
+        }
+
+        // The first run warms up caches, the second measures allocations and
+        // decides how many runs a single sample needs to be long enough to time.
+        doNotOptimize(body());
+        AllocationStats before = totalAllocations();
+        resetPeakHeapBytes();
+        unsigned long long liveBefore = liveHeapBytes();
+        auto start = Clock::now();
+        doNotOptimize(body());
+        double singleRunNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        AllocationStats after = totalAllocations();
+        unsigned long long peakBytes = peakHeapBytes() - liveBefore;
+
+        unsigned long long runsPerSample = singleRunNs >= minSampleNs ? 1 : (unsigned long long) (minSampleNs / std::max(singleRunNs, 1.0)) + 1;
+
+        std::vector<double> samples;
+        auto suiteStart = Clock::now();
+        while (samples.size() < minSamples
+            || (samples.size() < maxSamples && std::chrono::duration<double>(Clock::now() - suiteStart).count() < mMinSeconds)) {
+            auto sampleStart = Clock::now();
+            for (unsigned long long i = 0; i < runsPerSample; i++) {
+                doNotOptimize(body());
+            }
+            double sampleNs = std::chrono::duration<double, std::nano>(Clock::now() - sampleStart).count();
+            samples.push_back(sampleNs / runsPerSample);
+        }
+
+        BenchmarkResult result = summarise(name, samples, runsPerSample);
+        result.allocations = after.allocations - before.allocations;
+        result.allocatedBytes = after.bytes - before.bytes;
+        result.peakBytes = peakBytes;
+        result.itemsPerRun = itemsPerRun;
+        result.itemName = itemName;
+        report(result);
+        mResults.push_back(result);
+    }
+
+    const std::vector<BenchmarkResult> &results() const { return mResults; }
+
+    // The result of the named benchmark, or nullptr if it was filtered out
+    const BenchmarkResult *result(std::string const &name) const;
+
+    // Records a failed expectation about the results. The suite still runs to the end.
+    void fail(std::string const &message);
+    bool failed() const { return mFailed; }
+
+    void writeJSON(std::ostream &out) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr double minSampleNs = 1e6;
+    static constexpr size_t minSamples = 5;
+    static constexpr size_t maxSamples = 1000;
+
+    static BenchmarkResult summarise(std::string const &name, std::vector<double> &samples, unsigned long long runsPerSample);
+    static void report(BenchmarkResult const &result);
+
+    std::string mFilter;
+    double mMinSeconds;
+    std::vector<BenchmarkResult> mResults;
+    bool mFailed = false;
+};
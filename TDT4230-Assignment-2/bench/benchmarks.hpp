@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+#include "benchmarkSuite.hpp"
+
+// Groups of benchmarks, one per file
+void benchmarkCompression(BenchmarkSuite &suite);
+void benchmarkGeometry(BenchmarkSuite &suite);
+void benchmarkImages(BenchmarkSuite &suite);
+void benchmarkImport(BenchmarkSuite &suite);
+void benchmarkScene(BenchmarkSuite &suite);
+
+// Texture-like RGBA test image: gradients with some noise, so that it neither
+// compresses trivially nor is pure noise
+std::vector<unsigned char> syntheticImage(unsigned int size);
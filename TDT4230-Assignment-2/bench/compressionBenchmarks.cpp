@@ -0,0 +1,174 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <utilities/textureCache.h>
+#include <utilities/textureCompression.h>
+#include "benchmarks.hpp"
+
+// Reference decoders, to measure what the encoders lose
+
+static void decodeColorBlock(const unsigned char *block, unsigned char *pixels) {
+    int palette[4][3];
+    for (int e = 0; e < 2; e++) {
+        int color = block[2 * e] | block[2 * e + 1] << 8;
+        int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+        palette[e][0] = r << 3 | r >> 2;
+        palette[e][1] = g << 2 | g >> 4;
+        palette[e][2] = b << 3 | b >> 2;
+    }
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    std::uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | std::uint32_t(block[7]) << 24;
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            pixels[4 * i + c] = (unsigned char) palette[indices >> (2 * i) & 3][c];
+        }
+    }
+}
+
+static void decodeChannelBlock(const unsigned char *block, int channel, unsigned char *pixels) {
+    int palette[8] = { block[0], block[1] };
+    for (int i = 2; i < 8; i++) {
+        palette[i] = block[0] > block[1] ? ((8 - i) * block[0] + (i - 1) * block[1]) / 7
+                   : i < 6 ? ((6 - i) * block[0] + (i - 1) * block[1]) / 5
+                   : (i == 6 ? 0 : 255);
+    }
+    std::uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= std::uint64_t(block[2 + i]) << (8 * i);
+    }
+    for (int i = 0; i < 16; i++) {
+        pixels[4 * i + channel] = (unsigned char) palette[indices >> (3 * i) & 7];
+    }
+}
+
+// Peak signal to noise ratio of the given channels of level 0, in dB
+static double levelZeroPSNR(const EncodedTexture &encoded, const std::vector<unsigned char> &source, unsigned int size, int firstChannel, int channelCount) {
+    const bool bc1 = encoded.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    const bool bc3 = encoded.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    const bool bc4 = encoded.format == GL_COMPRESSED_RED_RGTC1;
+    const size_t blockBytes = bc1 || bc4 ? 8 : 16;
+    unsigned int blocksWide = size / 4;
+
+    double squaredError = 0;
+    unsigned char pixels[64];
+    for (unsigned int by = 0; by < size / 4; by++) {
+        for (unsigned int bx = 0; bx < blocksWide; bx++) {
+            const unsigned char *block = encoded.data.data() + (by * blocksWide + bx) * blockBytes;
+            if (bc1) {
+                decodeColorBlock(block, pixels);
+            } else if (bc3) {
+                decodeChannelBlock(block, 3, pixels);
+                decodeColorBlock(block + 8, pixels);
+            } else if (bc4) {
+                decodeChannelBlock(block, 0, pixels);
+            } else {
+                decodeChannelBlock(block, 0, pixels);
+                decodeChannelBlock(block + 8, 1, pixels);
+            }
+            for (unsigned int i = 0; i < 16; i++) {
+                size_t pixel = 4 * ((4 * by + i / 4) * size_t(size) + 4 * bx + i % 4);
+                for (int c = firstChannel; c < firstChannel + channelCount; c++) {
+                    double difference = double(pixels[4 * i + c]) - source[pixel + c];
+                    squaredError += difference * difference;
+                }
+            }
+        }
+    }
+    double meanSquaredError = squaredError / (double(size) * size * channelCount);
+    return meanSquaredError == 0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+// Normals of a height field made from the test image
+static std::vector<unsigned char> syntheticNormalMap(unsigned int size) {
+    std::vector<unsigned char> height = syntheticImage(size);
+    std::vector<unsigned char> pixels(4 * size * size);
+    for (unsigned int y = 0; y < size; y++) {
+        for (unsigned int x = 0; x < size; x++) {
+            float dx = (height[4 * (y * size + (x + 1) % size)] - height[4 * (y * size + (x + size - 1) % size)]) / 255.0f;
+            float dy = (height[4 * (((y + 1) % size) * size + x)] - height[4 * (((y + size - 1) % size) * size + x)]) / 255.0f;
+            float length = std::sqrt(dx * dx + dy * dy + 1.0f);
+            unsigned char *pixel = &pixels[4 * (y * size + x)];
+            pixel[0] = (unsigned char) std::lround((-dx / length + 1.0f) * 127.5f);
+            pixel[1] = (unsigned char) std::lround((-dy / length + 1.0f) * 127.5f);
+            pixel[2] = (unsigned char) std::lround((1.0f / length + 1.0f) * 127.5f);
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+void benchmarkCompression(BenchmarkSuite &suite) {
+    const unsigned int size = 1024;
+    const double pixelCount = double(size) * size;
+
+    PNGImage color = { size, size, syntheticImage(size) };
+    PNGImage translucent = color;
+    for (size_t i = 3; i < translucent.pixels.size(); i += 4) {
+        translucent.pixels[i] = (unsigned char) (i / 4 % size * 255 / size);
+    }
+    PNGImage normals = { size, size, syntheticNormalMap(size) };
+
+    // The quality each format reached on these images when the encoder was
+    // written, less about 1 dB of slack
+    struct Case {
+        const char *name;
+        const PNGImage &image;
+        TextureKind kind;
+        int firstChannel;
+        int channelCount;
+        double minimumPSNR;
+    };
+    const Case cases[] = {
+        { "bc1", color,       TEXTURE_COLOR,          0, 3, 28.6 },
+        { "bc3", translucent, TEXTURE_COLOR,          0, 4, 29.9 },
+        { "bc4", color,       TEXTURE_SINGLE_CHANNEL, 0, 1, 36.7 },
+        { "bc5", normals,     TEXTURE_NORMAL_MAP,     0, 2, 38.5 },
+    };
+
+    ThreadPool singleThread(0);
+    for (const Case &test : cases) {
+        std::string name = fmt::format("encodeTexture/{}_{}x{}", test.name, size, size);
+        if (!suite.matches(name) && !suite.matches(name + "/single_thread")) {
+            continue;
+        }
+        suite.run(name, [&]() {
+            return encodeTexture(test.image, test.kind, true);
+        }, pixelCount, "pixels");
+        suite.run(name + "/single_thread", [&]() {
+            return encodeTexture(test.image, test.kind, true, singleThread);
+        }, pixelCount, "pixels");
+
+        EncodedTexture encoded = encodeTexture(test.image, test.kind, true);
+        double psnr = levelZeroPSNR(encoded, test.image.pixels, size, test.firstChannel, test.channelCount);
+        std::cerr << fmt::format("{:<40} {:.2f} dB", name, psnr) << std::endl;
+        if (psnr < test.minimumPSNR) {
+            suite.fail(fmt::format("{} reaches {:.2f} dB, below its minimum of {:.1f} dB", name, psnr, test.minimumPSNR));
+        }
+    }
+
+    // Without S3TC only the mip chain is built, filtered in linear light
+    std::string mipName = fmt::format("encodeTexture/rgba8_{}x{}", size, size);
+    suite.run(mipName, [&]() {
+        return encodeTexture(color, TEXTURE_COLOR, false);
+    }, pixelCount, "pixels");
+    suite.run(mipName + "/single_thread", [&]() {
+        return encodeTexture(color, TEXTURE_COLOR, false, singleThread);
+    }, pixelCount, "pixels");
+
+    // What a warm start does instead of decoding and encoding
+    const char *cacheFile = "bench_texture.tex";
+    if (suite.matches("loadTextureCache") && writeTextureCache(cacheFile, 1, encodeTexture(color, TEXTURE_COLOR, true))) {
+        suite.run(fmt::format("loadTextureCache/bc1_{}x{}", size, size), [&]() {
+            MappedTexture texture;
+            loadTextureCache(cacheFile, 1, texture);
+            return texture.size;
+        }, pixelCount, "pixels");
+        std::remove(cacheFile);
+    }
+}
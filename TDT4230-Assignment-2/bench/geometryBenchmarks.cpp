@@ -0,0 +1,102 @@
+#include <string>
+#include <fmt/format.h>
+#include <utilities/shapes.h>
+#include <utilities/glutils.h>
+#include <utilities/glfont.h>
+#include <utilities/meshOptimizer.h>
+#include <utilities/meshSimplifier.h>
+#include <utilities/tangentSpace.h>
+#include "benchmarks.hpp"
+
+void benchmarkGeometry(BenchmarkSuite &suite) {
+    const int sphereResolutions[] = {10, 40, 160};
+
+    for (int resolution : sphereResolutions) {
+        suite.run(fmt::format("generateSphere/{}x{}", resolution, resolution), [&]() {
+            return generateSphere(1.0, resolution, resolution);
+        }, 6.0 * resolution * resolution, "vertices");
+    }
+
+    suite.run("cube/plain", []() {
+        return cube();
+    }, 36, "vertices");
+    suite.run("cube/tiled_inverted", []() {
+        return cube(glm::vec3(180, 90, 90), glm::vec2(90), true, true);
+    }, 36, "vertices");
+
+    // Welded, like the meshes the game uploads. The largest size is above
+    // parallelTangentTriangleCount, so it is also timed on a single thread.
+    ThreadPool singleThread(0);
+    const int tangentResolutions[] = {10, 40, 160, 512};
+    for (int resolution : tangentResolutions) {
+        Mesh sphere = generateSphere(1.0, resolution, resolution);
+        optimizeMesh(sphere);
+        std::vector<glm::vec4> tangents(sphere.vertices.size());
+        suite.run(fmt::format("generateTangents/sphere_{}x{}", resolution, resolution), [&]() {
+            generateTangents(sphere, tangents.data());
+            return tangents[0];
+        }, (double) sphere.vertices.size(), "vertices");
+        if (sphere.indices.size() / 3 >= parallelTangentTriangleCount) {
+            suite.run(fmt::format("generateTangents/sphere_{}x{}/single_thread", resolution, resolution), [&]() {
+                generateTangents(sphere, tangents.data(), singleThread);
+                return tangents[0];
+            }, (double) sphere.vertices.size(), "vertices");
+        }
+    }
+
+    for (int resolution : sphereResolutions) {
+        Mesh sphere = generateSphere(1.0, resolution, resolution);
+        suite.run(fmt::format("optimizeMesh/sphere_{}x{}", resolution, resolution), [&]() {
+            Mesh mesh = sphere;
+            optimizeMesh(mesh);
+            return mesh.indices.size();
+        }, (double) sphere.vertices.size(), "vertices");
+    }
+
+    for (int resolution : sphereResolutions) {
+        Mesh sphere = generateSphere(1.0, resolution, resolution);
+        optimizeMesh(sphere);
+        suite.run(fmt::format("simplifyMesh/sphere_{}x{}/half", resolution, resolution), [&]() {
+            Mesh mesh = sphere;
+            simplifyMesh(mesh, mesh.indices.size() / 2);
+            return mesh.indices.size();
+        }, sphere.indices.size() / 3.0, "triangles");
+    }
+
+    // Packing and the whole path from parameters to upload-ready bytes must
+    // allocate the same number of times for every size of mesh
+    const char *sizeIndependentBenchmarks[] = {"packMesh", "buildMesh"};
+    for (int resolution : sphereResolutions) {
+        Mesh sphere = generateSphere(1.0, resolution, resolution);
+        optimizeMesh(sphere);
+        suite.run(fmt::format("packMesh/sphere_{}x{}", resolution, resolution), [&]() {
+            return packMesh(sphere).vertexData.size();
+        }, (double) sphere.vertices.size(), "vertices");
+        suite.run(fmt::format("buildMesh/sphere_{}x{}", resolution, resolution), [&]() {
+            Mesh mesh = generateSphere(1.0, resolution, resolution);
+            optimizeMesh(mesh);
+            return packMesh(mesh).vertexData.size();
+        }, 6.0 * resolution * resolution, "vertices");
+    }
+    for (const char *benchmark : sizeIndependentBenchmarks) {
+        const BenchmarkResult *smallest = suite.result(fmt::format("{}/sphere_{}x{}", benchmark, sphereResolutions[0], sphereResolutions[0]));
+        for (int resolution : sphereResolutions) {
+            const BenchmarkResult *result = suite.result(fmt::format("{}/sphere_{}x{}", benchmark, resolution, resolution));
+            if (smallest != nullptr && result != nullptr && result->allocations != smallest->allocations) {
+                suite.fail(fmt::format("{} makes {} allocations, but {} at the smallest size",
+                                       result->name, result->allocations, smallest->allocations));
+            }
+        }
+    }
+
+    const size_t textLengths[] = {16, 128, 1024};
+    for (size_t length : textLengths) {
+        std::string text;
+        for (size_t i = 0; i < length; i++) {
+            text += char(' ' + i % 95);
+        }
+        suite.run(fmt::format("generateTextGeometryBuffer/{}_chars", length), [&]() {
+            return generateTextGeometryBuffer(text, 39.0 / 29.0, 700.0);
+        }, (double) length, "characters");
+    }
+}
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <utilities/imageLoader.hpp>
+#include "benchmarks.hpp"
+
+std::vector<unsigned char> syntheticImage(unsigned int size) {
+    std::vector<unsigned char> pixels(4 * size * size);
+    unsigned int seed = 12345;
+    for (unsigned int y = 0; y < size; y++) {
+        for (unsigned int x = 0; x < size; x++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned char noise = (seed >> 16) & 31;
+            unsigned char *pixel = &pixels[4 * (y * size + x)];
+            pixel[0] = (unsigned char) (x * 255 / size + noise);
+            pixel[1] = (unsigned char) (y * 255 / size + noise);
+            pixel[2] = (unsigned char) ((x ^ y) + noise);
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+static bool fileExists(std::string const &fileName) {
+    return std::ifstream(fileName).good();
+}
+
+struct EncodedImage {
+    std::string name;
+    std::vector<unsigned char> data;
+};
+
+// Time taken by one decoder on all images of a format
+struct DecoderTotal {
+    double ns = 0;
+    double megabytes = 0;
+    unsigned int images = 0;
+};
+
+// Times every decoder that reads each of our textures, decoding from memory so
+// that reading the file is left out. Raw copies of the PNGs give the cost of
+// just copying the pixels, which no decoder can beat.
+static void benchmarkDecoders(BenchmarkSuite &suite) {
+    std::vector<EncodedImage> images;
+    EncodedImage synthetic = { "synthetic_1024.png", {} };
+    if (lodepng::encode(synthetic.data, syntheticImage(1024), 1024, 1024) == 0) {
+        images.push_back(synthetic);
+    }
+    std::vector<std::string> textures;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator("../res/textures", error)) {
+        if (entry.path().extension() == ".png") {
+            textures.push_back(entry.path().string());
+        }
+    }
+    std::sort(textures.begin(), textures.end());
+    for (const std::string &texture : textures) {
+        EncodedImage image = { std::filesystem::path(texture).filename().string(), {} };
+        if (lodepng::load_file(image.data, texture) == 0) {
+            images.push_back(image);
+        }
+    }
+    size_t pngCount = images.size();
+    for (size_t i = 0; i < pngCount; i++) {
+        PNGImage decoded;
+        if (decodeImage(DECODER_LODEPNG, images[i].data.data(), images[i].data.size(), decoded)) {
+            std::string name = images[i].name.substr(0, images[i].name.rfind('.')) + ".raw";
+            images.push_back({ name, encodeRawImage(decoded) });
+        }
+    }
+
+    const char *formatNames[] = { "PNG", "raw", "other" };
+    const ImageDecoder decoders[] = { DECODER_LODEPNG, DECODER_STB_IMAGE, DECODER_RAW };
+    DecoderTotal totals[IMAGE_OTHER + 1][DECODER_RAW + 1];
+    for (const EncodedImage &image : images) {
+        ImageFormat format = detectImageFormat(image.data.data(), image.data.size());
+        PNGImage reference;
+        if (!decodeImage(preferredDecoder(format), image.data.data(), image.data.size(), reference)) {
+            suite.fail(fmt::format("{} could not be decoded", image.name));
+            continue;
+        }
+        double megabytes = reference.pixels.size() / 1e6;
+
+        for (ImageDecoder decoder : decoders) {
+            if (!decoderSupports(decoder, format)) {
+                continue;
+            }
+            std::string name = fmt::format("decodeImage/{}/{}", imageDecoderName(decoder), image.name);
+            if (!suite.matches(name)) {
+                continue;
+            }
+            // Decoders are only interchangeable if they agree on every pixel
+            PNGImage decoded;
+            decodeImage(decoder, image.data.data(), image.data.size(), decoded);
+            if (decoded.width != reference.width || decoded.height != reference.height || decoded.pixels != reference.pixels) {
+                suite.fail(fmt::format("{} decodes {} differently from {}", imageDecoderName(decoder),
+                                       image.name, imageDecoderName(preferredDecoder(format))));
+            }
+
+            suite.run(name, [&]() {
+                PNGImage decoded;
+                decodeImage(decoder, image.data.data(), image.data.size(), decoded);
+                return decoded;
+            }, megabytes, "MB");
+            const BenchmarkResult *result = suite.result(name);
+            if (result != nullptr) {
+                DecoderTotal &total = totals[format][decoder];
+                total.ns += result->medianNs;
+                total.megabytes += megabytes;
+                total.images++;
+            }
+        }
+    }
+
+    // What the preferred decoder of each format should be, from these images
+    for (int format = IMAGE_PNG; format <= IMAGE_OTHER; format++) {
+        const ImageDecoder *fastest = nullptr;
+        for (const ImageDecoder &decoder : decoders) {
+            const DecoderTotal &total = totals[format][decoder];
+            if (total.images == 0) {
+                continue;
+            }
+            std::cerr << fmt::format("{} images with {}: {:.2f} ms per image, {:.1f} MB/s", formatNames[format],
+                                     imageDecoderName(decoder), total.ns * 1e-6 / total.images,
+                                     total.megabytes / (total.ns * 1e-9)) << std::endl;
+            if (fastest == nullptr || total.ns < totals[format][*fastest].ns) {
+                fastest = &decoder;
+            }
+        }
+        if (fastest != nullptr) {
+            std::cerr << fmt::format("Fastest for {} images: {}, preferred: {}", formatNames[format],
+                                     imageDecoderName(*fastest), imageDecoderName(preferredDecoder((ImageFormat) format))) << std::endl;
+        }
+    }
+}
+
+void benchmarkImages(BenchmarkSuite &suite) {
+    benchmarkDecoders(suite);
+
+    const unsigned int sizes[] = {256, 1024, 2048};
+
+    for (unsigned int size : sizes) {
+        std::string fileName = fmt::format("bench_{}.png", size);
+        unsigned error = lodepng::encode(fileName, syntheticImage(size), size, size);
+        if (error) {
+            std::cerr << "Could not write " << fileName << ": " << lodepng_error_text(error) << std::endl;
+            continue;
+        }
+
+        double bytes = 4.0 * size * size;
+        suite.run(fmt::format("loadPNGFile/{}x{}", size, size), [&]() {
+            return loadPNGFile(fileName);
+        }, bytes, "bytes");
+
+        std::remove(fileName.c_str());
+    }
+
+    // Several textures at once, like the game loads them, against one after the other
+    const unsigned int batchSize = 1024;
+    std::vector<std::string> batch;
+    for (int i = 0; i < 4; i++) {
+        std::string fileName = fmt::format("bench_batch_{}.png", i);
+        if (lodepng::encode(fileName, syntheticImage(batchSize), batchSize, batchSize) == 0) {
+            batch.push_back(fileName);
+        }
+    }
+    double batchBytes = 4.0 * batchSize * batchSize * batch.size();
+    std::string batchName = fmt::format("loadPNGFiles/{}x{}x{}", batch.size(), batchSize, batchSize);
+    suite.run(batchName, [&]() {
+        return loadPNGFiles(batch);
+    }, batchBytes, "bytes");
+    suite.run(batchName + "/serial", [&]() {
+        std::vector<PNGImage> images;
+        for (const std::string &fileName : batch) {
+            images.push_back(loadPNGFile(fileName));
+        }
+        return images;
+    }, batchBytes, "bytes");
+    for (const std::string &fileName : batch) {
+        std::remove(fileName.c_str());
+    }
+
+    // The textures actually used by the game, when they are present
+    const char *textures[] = {
+        "../res/textures/charmap.png",
+        "../res/textures/Brick03_col.png",
+        "../res/textures/Brick03_nrm.png",
+        "../res/textures/Brick03_rgh.png",
+    };
+    for (const char *texture : textures) {
+        if (!fileExists(texture)) {
+            continue;
+        }
+        std::string name = std::string(texture).substr(std::string(texture).rfind('/') + 1);
+        suite.run(fmt::format("loadPNGFile/{}", name), [&]() {
+            return loadPNGFile(texture);
+        });
+    }
+}
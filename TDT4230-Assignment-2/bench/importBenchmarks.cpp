@@ -0,0 +1,96 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <fmt/format.h>
+#include <utilities/meshOptimizer.h>
+#include <utilities/objImporter.h>
+#include <utilities/shapes.h>
+#include "benchmarks.hpp"
+
+// Writes a welded sphere as an OBJ file, the way exporters write meshes
+static void writeSphereOBJ(const std::string &fileName, int resolution) {
+    Mesh sphere = generateSphere(1.0, resolution, resolution);
+    optimizeMesh(sphere);
+
+    std::ofstream out(fileName, std::ios::binary);
+    for (size_t i = 0; i < sphere.vertices.size(); i++) {
+        out << fmt::format("v {} {} {}\nvt {} {}\nvn {} {} {}\n",
+                           sphere.vertices[i].x, sphere.vertices[i].y, sphere.vertices[i].z,
+                           sphere.textureCoordinates[i].x, sphere.textureCoordinates[i].y,
+                           sphere.normals[i].x, sphere.normals[i].y, sphere.normals[i].z);
+    }
+    for (size_t i = 0; i < sphere.indices.size(); i += 3) {
+        out << fmt::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n",
+                           sphere.indices[i] + 1, sphere.indices[i + 1] + 1, sphere.indices[i + 2] + 1);
+    }
+}
+
+// The baseline: line by line through iostreams on one thread, the way OBJ
+// loaders are usually first written. Only handles what writeSphereOBJ() writes.
+static Mesh naiveImportOBJ(const std::string &fileName) {
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> textureCoordinates;
+    Mesh mesh;
+
+    std::ifstream in(fileName);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "v") {
+            glm::vec3 position;
+            words >> position.x >> position.y >> position.z;
+            positions.push_back(position);
+        } else if (keyword == "vt") {
+            glm::vec2 textureCoordinate;
+            words >> textureCoordinate.x >> textureCoordinate.y;
+            textureCoordinates.push_back(textureCoordinate);
+        } else if (keyword == "vn") {
+            glm::vec3 normal;
+            words >> normal.x >> normal.y >> normal.z;
+            normals.push_back(normal);
+        } else if (keyword == "f") {
+            std::string corner;
+            while (words >> corner) {
+                size_t firstSlash = corner.find('/');
+                size_t secondSlash = corner.find('/', firstSlash + 1);
+                mesh.indices.push_back((unsigned int) mesh.vertices.size());
+                mesh.vertices.push_back(positions[std::stoi(corner.substr(0, firstSlash)) - 1]);
+                mesh.textureCoordinates.push_back(textureCoordinates[std::stoi(corner.substr(firstSlash + 1, secondSlash - firstSlash - 1)) - 1]);
+                mesh.normals.push_back(normals[std::stoi(corner.substr(secondSlash + 1)) - 1]);
+            }
+        }
+    }
+    return mesh;
+}
+
+void benchmarkImport(BenchmarkSuite &suite) {
+    const int resolution = 384;
+    const double triangles = 2.0 * resolution * resolution;
+    std::string name = fmt::format("importOBJ/sphere_{}x{}", resolution, resolution);
+    if (!suite.matches(name) && !suite.matches(name + "/single_thread") && !suite.matches(name + "/naive")) {
+        return;
+    }
+
+    std::string fileName = (std::filesystem::temp_directory_path() / "glowbox_bench_sphere.obj").string();
+    writeSphereOBJ(fileName, resolution);
+
+    ThreadPool singleThread(0);
+    suite.run(name, [&]() {
+        Mesh mesh;
+        importOBJ(fileName, mesh);
+        return mesh.indices.size();
+    }, triangles, "triangles");
+    suite.run(name + "/single_thread", [&]() {
+        Mesh mesh;
+        importOBJ(fileName, mesh, singleThread);
+        return mesh.indices.size();
+    }, triangles, "triangles");
+    suite.run(name + "/naive", [&]() {
+        return naiveImportOBJ(fileName).indices.size();
+    }, triangles, "triangles");
+
+    std::filesystem::remove(fileName);
+}
@@ -0,0 +1,58 @@
+// Micro-benchmarks of the CPU side of the engine. Runs without a window or GL context.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <arrrgh.hpp>
+#include "benchmarks.hpp"
+
+int main(int argc, const char* argb[])
+{
+    arrrgh::parser parser("glowbox_bench", "Micro-benchmarks of the CPU side of glowbox");
+    const auto& showHelp = parser.add<bool>("help", "Show this help message.", 'h', arrrgh::Optional, false);
+    const auto& filter   = parser.add<std::string>("filter", "Only run benchmarks whose name contains this string.", 'f', arrrgh::Optional, "");
+    const auto& output   = parser.add<std::string>("output", "Write the results as JSON to this file instead of stdout.", 'o', arrrgh::Optional, "");
+    const auto& minTime  = parser.add<int>("min-time-ms", "Minimum time spent sampling each benchmark.", 't', arrrgh::Optional, 200);
+
+    try
+    {
+        parser.parse(argc, argb);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error parsing arguments: " << e.what() << std::endl;
+        parser.show_usage(std::cerr);
+        exit(1);
+    }
+
+    if(showHelp.value())
+    {
+        parser.show_usage(std::cout);
+        return 0;
+    }
+
+    BenchmarkSuite suite(filter.value(), minTime.value() / 1000.0);
+
+    benchmarkCompression(suite);
+    benchmarkGeometry(suite);
+    benchmarkImages(suite);
+    benchmarkImport(suite);
+    benchmarkScene(suite);
+
+    if (output.value().empty())
+    {
+        suite.writeJSON(std::cout);
+    }
+    else
+    {
+        std::ofstream out(output.value());
+        if (out.fail())
+        {
+            std::cerr << "Could not write " << output.value() << std::endl;
+            return EXIT_FAILURE;
+        }
+        suite.writeJSON(out);
+    }
+
+    return suite.failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
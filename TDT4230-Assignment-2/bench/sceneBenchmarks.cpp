@@ -0,0 +1,72 @@
+#include <vector>
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <sceneGraph.hpp>
+#include <timestamps.h>
+#include "benchmarks.hpp"
+
+// Looks up the keyframe for every frame of a playthrough at 60 fps, like updateGameLogic does
+static unsigned int playThrough(const std::vector<double> &timeStamps, double songLength) {
+    unsigned int keyFrame = 0;
+    unsigned int checksum = 0;
+    for (double time = 0; time < songLength; time += 1.0 / 60.0) {
+        keyFrame = findKeyFrame(timeStamps, keyFrame, time);
+        checksum += keyFrame;
+    }
+    return checksum;
+}
+
+// Builds a tree with the given number of nodes, where every node has up to `branching` children
+static SceneNode *buildTree(unsigned int nodeCount, unsigned int branching) {
+    std::vector<SceneNode*> nodes;
+    nodes.reserve(nodeCount);
+    for (unsigned int i = 0; i < nodeCount; i++) {
+        SceneNode *node = createSceneNode(i % 16 == 15 ? POINT_LIGHT : GEOMETRY);
+        node->position = glm::vec3(i % 7, i % 5, i % 3);
+        node->rotation = glm::vec3(0.1f * (i % 11), 0.2f * (i % 13), 0);
+        node->scale = glm::vec3(1 + (i % 2));
+        if (i > 0) {
+            addChild(nodes[(i - 1) / branching], node);
+        }
+        nodes.push_back(node);
+    }
+    return nodes.front();
+}
+
+static void deleteTree(SceneNode *node) {
+    for (SceneNode *child : node->children) {
+        deleteTree(child);
+    }
+    delete node;
+}
+
+void benchmarkScene(BenchmarkSuite &suite) {
+    // The last keyframe is a sentinel far into the future
+    double songLength = keyFrameTimeStamps.at(keyFrameTimeStamps.size() - 2);
+    suite.run("findKeyFrame/song", [&]() {
+        return playThrough(keyFrameTimeStamps, songLength);
+    }, songLength * 60.0, "lookups");
+
+    const unsigned int tableSizes[] = {256, 2048};
+    for (unsigned int size : tableSizes) {
+        std::vector<double> timeStamps(size);
+        for (unsigned int i = 0; i < size; i++) {
+            timeStamps[i] = i * 0.5;
+        }
+        suite.run(fmt::format("findKeyFrame/{}_keyframes", size), [&]() {
+            return playThrough(timeStamps, timeStamps.back());
+        }, timeStamps.back() * 60.0, "lookups");
+    }
+
+    const unsigned int treeSizes[] = {16, 256, 4096, 65536};
+    glm::mat4 VP = glm::perspective(glm::radians(80.0f), 16.0f / 9.0f, 0.1f, 350.f);
+    glm::mat4 identity(1);
+    for (unsigned int size : treeSizes) {
+        SceneNode *root = buildTree(size, 4);
+        suite.run(fmt::format("updateNodeTransformations/{}_nodes", size), [&]() {
+            updateNodeTransformations(root, identity, VP);
+            return root->modelMatrix;
+        }, size, "nodes");
+        deleteTree(root);
+    }
+}
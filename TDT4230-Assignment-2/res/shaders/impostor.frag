@@ -0,0 +1,49 @@
+#version 430 core
+
+// Intersects the view ray with the sphere the quad from impostor.vert covers,
+// and shades the hit like simple.frag shades the ball mesh.
+
+in layout(location = 0) vec3 ray_direction_in;
+in layout(location = 1) flat vec4 sphere_in;
+
+uniform layout(location = 3) mat4 view;
+uniform layout(location = 4) mat4 projection;
+uniform layout(location = 6) vec3 view_position;
+
+// The hit is never in front of the quad, which keeps early depth testing on
+layout(depth_greater) out float gl_FragDepth;
+out vec4 color;
+
+// From lighting.frag
+float dither(vec2 uv);
+vec3 phong_lighting(vec3 frag_pos, vec3 normal, float roughness);
+
+void main()
+{
+    vec3 direction = normalize(ray_direction_in);
+    vec3 center = sphere_in.xyz;
+    float radius = sphere_in.w;
+
+    // Nearest solution of |view_position + t * direction - center| = radius
+    vec3 to_center = center - view_position;
+    float b = dot(to_center, direction);
+    float discriminant = b * b - (dot(to_center, to_center) - radius * radius);
+    if (discriminant < 0) {
+        discard;
+    }
+    float t = b - sqrt(discriminant);
+    if (t < 0) {
+        discard;
+    }
+
+    vec3 frag_pos = view_position + t * direction;
+    vec3 normal = (frag_pos - center) / radius;
+
+    vec4 clip_position = projection * view * vec4(frag_pos, 1.0);
+    gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip_position.z / clip_position.w + gl_DepthRange.near + gl_DepthRange.far);
+
+    // Spherical coordinates stand in for the mesh's texture coordinates, which only seed the dither
+    vec2 texture_coordinates = vec2(atan(normal.z, normal.x), acos(clamp(normal.y, -1.0, 1.0)));
+    color = vec4(0.6, 0.6, 0.6, 1.0);
+    color = (vec4(phong_lighting(frag_pos, normal, 0.5), 1.0) + dither(texture_coordinates)) * color;
+}
@@ -0,0 +1,74 @@
+#version 430 core
+
+// Draws every sphere as one quad covering its bounds on screen, from four
+// vertices without attributes. impostor.frag casts the view rays.
+
+// Centre in xyz, radius in w
+layout(std430, binding = 0) readonly buffer Spheres {
+    vec4 spheres[];
+};
+
+// The view matrix must not scale
+uniform layout(location = 3) mat4 view;
+uniform layout(location = 4) mat4 projection;
+
+out layout(location = 0) vec3 ray_direction_out;
+out layout(location = 1) flat vec4 sphere_out;
+
+// The projected extent of a sphere along one screen axis, from the two planes
+// through the eye that touch it (Mara and McGuire, "2D Polyhedral Bounds of a
+// Clipped, Perspective-Projected 3D Sphere"). c is the view space centre as
+// (coordinate along the axis, z), scale the projection's scale on that axis.
+vec2 projected_extent(vec2 c, float radius, float scale)
+{
+    float c_length = length(c);
+    float cos_theta = sqrt(dot(c, c) - radius * radius) / c_length;
+    float sin_theta = radius / c_length;
+    mat2 rotation = mat2(cos_theta, sin_theta, -sin_theta, cos_theta);
+    // The points where the planes touch the sphere
+    vec2 a = cos_theta * (rotation * c);
+    vec2 b = cos_theta * (transpose(rotation) * c);
+    float projected_a = scale * a.x / -a.y;
+    float projected_b = scale * b.x / -b.y;
+    return vec2(min(projected_a, projected_b), max(projected_a, projected_b));
+}
+
+void main()
+{
+    vec4 sphere = spheres[gl_InstanceID];
+    vec3 center = vec3(view * vec4(sphere.xyz, 1.0));
+    float radius = sphere.w;
+    float near = projection[3][2] / (projection[2][2] - 1);
+
+    // Spheres wholly between the eye and the near plane, or behind the eye,
+    // are clipped. Put the quad outside the clip volume instead of shading the
+    // whole screen for them.
+    if (center.z - radius > -near) {
+        gl_Position = vec4(0, 0, 2, 1);
+        return;
+    }
+
+    // Spheres that straddle the near plane, or contain the eye, cover the screen
+    vec2 x_extent = vec2(-1, 1);
+    vec2 y_extent = vec2(-1, 1);
+    float z = -near;
+    if (-center.z - radius > near) {
+        x_extent = projected_extent(center.xz, radius, projection[0][0]);
+        y_extent = projected_extent(center.yz, radius, projection[1][1]);
+        // The nearest point of the sphere, so that occluded quads fail the
+        // depth test before their fragments are shaded
+        z = center.z + radius;
+    }
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 position = mix(vec2(x_extent.x, y_extent.x), vec2(x_extent.y, y_extent.y), corner);
+    float depth = (projection[2][2] * z + projection[3][2]) / -z;
+
+    // The view ray through this corner in world space. It is linear across the
+    // quad, so it interpolates exactly.
+    vec3 view_direction = vec3(position.x / projection[0][0], position.y / projection[1][1], -1);
+    ray_direction_out = transpose(mat3(view)) * view_direction;
+    sphere_out = sphere;
+
+    gl_Position = vec4(position, depth, 1.0);
+}
@@ -0,0 +1,82 @@
+#version 430 core
+
+// Lighting shared by the 3D fragment shaders, which link this file in as a
+// second fragment shader and declare the functions they call.
+//
+// Compiled with LIGHT_SOURCES defined to the size of light_sources, and with
+// BALL_SHADOW defined if the ball casts a shadow.
+
+#define BALL_RADIUS 3
+
+// Data structures
+struct LightSource {
+    vec3 position;
+    vec3 color;
+};
+
+uniform layout(location = 6) vec3 view_position;
+uniform LightSource light_sources[LIGHT_SOURCES];
+uniform vec3 ball_position;
+
+float rand(vec2 co) { return fract(sin(dot(co.xy, vec2(12.9898,78.233))) * 43758.5453); }
+float dither(vec2 uv) { return (rand(uv)*2.0-1.0) / 256.0; }
+vec3 reject(vec3 from, vec3 onto) { return from - onto*dot(from, onto)/dot(onto, onto); }
+
+// Ambient, diffuse and specular light at a point, with the ball's shadow if it casts one
+vec3 phong_lighting(vec3 frag_pos_in, vec3 normal, float roughness)
+{
+    // Ambient
+    vec3 ambient_light = vec3(0.08, 0.08, 0.08);
+    vec3 ambient = ambient_light;// * color.rgb;
+
+    // Attenuation
+    float l_a = 0.25;
+    float l_b = 0.05;
+    float l_c = 0.005;
+
+    vec3 diffuse = vec3(0.0, 0.0, 0.0);
+    vec3 specular = vec3(0.0, 0.0, 0.0);
+    
+    for (int i = 0; i < LIGHT_SOURCES; i++) {
+        vec3 light_position = light_sources[i].position;
+        vec3 light_color = light_sources[i].color;
+
+#ifdef BALL_SHADOW
+        // Shadow calculation
+        float shadow_factor = 0; // 0 means no shadow, 1 means maximum shadow
+        vec3 frag_light = frag_pos_in - light_position;
+        vec3 frag_ball  = frag_pos_in - ball_position;
+        // Check if light is closer to frag than ball and not pointing opposite directions
+        if (length(frag_light) >= length(frag_ball) && dot(frag_ball, frag_light) > 0) {
+            float reject_len = length(reject(frag_ball, frag_light));
+            if (reject_len < BALL_RADIUS) {
+                shadow_factor = 1.0;
+            } else if (reject_len < BALL_RADIUS * 1.5) {
+                // Soft shadow
+                float t = (reject_len - BALL_RADIUS) / (BALL_RADIUS * 0.5);
+                shadow_factor = mix(0.75, 0.0, t); // Linearly interpolate between 0.75 and 0
+            }
+        }
+        light_color *= (1 - shadow_factor);
+#endif
+
+        // PHONG
+        // Attenuation
+        float dist = distance(light_position, frag_pos_in);
+        float L = 1 / (l_a + dist * l_b + dist * dist * l_c);
+
+        // Diffuse
+        vec3 light_dir = normalize(light_position - frag_pos_in);
+        float intensity = max(dot(light_dir, normal), 0.0);
+        diffuse += L * intensity * light_color;
+
+        // Specular
+        vec3 reflect_dir = reflect(-light_dir, normal);
+        vec3 surface_eye = normalize(view_position - frag_pos_in);
+        float shininess = 5 / (roughness * roughness); // 32.0;
+        float spec_intensity = pow(max(dot(reflect_dir, surface_eye), 0.0), shininess);
+        specular += L * spec_intensity * light_color;
+    }
+
+    return ambient + diffuse + specular;
+}
@@ -3,8 +3,7 @@
 in layout(location = 0) vec3 position;
 in layout(location = 1) vec3 normal_in;
 in layout(location = 2) vec2 texture_coordinates_in;
-in layout(location = 3) vec3 tangent_in;
-in layout(location = 4) vec3 bitangent_in;
+in layout(location = 3) vec4 tangent_frame_in; // Quaternion, the sign of w flips the bitangent
 
 uniform layout(location = 3) mat4 MVP;
 uniform layout(location = 4) mat4 model_matrix;
@@ -20,13 +19,12 @@ void main()
     // To frag shader
     normal_out = normalize(normal_matrix * normal_in);
     texture_coordinates_out = texture_coordinates_in;
-    //TBN_out = transpose(mat3(
-    //    tangent_in,
-    //    bitangent_in,
-    //    normal_in)); 
-    // Unsure why we need to normalize the tangent and bitangent when I thought we specified them
-    // to be normalized in the generateAttribute call.
-    TBN_out = mat3(normalize(tangent_in), normalize(bitangent_in), normal_out);
+    // Rotate the x and z axes by the tangent frame quaternion
+    vec4 q = normalize(tangent_frame_in);
+    vec3 tangent = vec3(1 - 2 * (q.y * q.y + q.z * q.z), 2 * (q.x * q.y + q.w * q.z), 2 * (q.x * q.z - q.w * q.y));
+    vec3 frame_normal = vec3(2 * (q.x * q.z + q.w * q.y), 2 * (q.y * q.z - q.w * q.x), 1 - 2 * (q.x * q.x + q.y * q.y));
+    vec3 bitangent = cross(frame_normal, tangent) * (q.w < 0 ? -1.0 : 1.0);
+    TBN_out = mat3(normalize(normal_matrix * tangent), normalize(normal_matrix * bitangent), normal_out);
 
     frag_pos_out = vec3(model_matrix * vec4(position, 1.0f));
 
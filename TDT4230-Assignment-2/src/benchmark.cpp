@@ -0,0 +1,135 @@
+#include "benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <fmt/format.h>
+#include <utilities/glstats.h>
+#include <utilities/allocationTracker.h>
+#include <utilities/programCache.h>
+
+static unsigned int framesToRecord = 0;
+static unsigned int framesSeen = 0;
+static std::vector<double> frameTimes;
+static std::chrono::steady_clock::time_point previousFrameEnd;
+
+// Sums of the per-frame counters over all recorded frames
+static GLFrameStats glTotals;
+static AllocationStats allocationTotals[ALLOCATION_PHASE_COUNT];
+
+void startBenchmark(unsigned int frames) {
+    framesToRecord = frames;
+    framesSeen = 0;
+    frameTimes.clear();
+    frameTimes.reserve(frames);
+    glTotals = GLFrameStats();
+    for (AllocationStats &phase : allocationTotals) {
+        phase = AllocationStats();
+    }
+    previousFrameEnd = std::chrono::steady_clock::now();
+}
+
+bool recordBenchmarkFrame() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double frameTime = std::chrono::duration<double, std::milli>(now - previousFrameEnd).count();
+    previousFrameEnd = now;
+
+    framesSeen++;
+    if (framesSeen <= benchmarkWarmupFrames) {
+        return false;
+    }
+
+    frameTimes.push_back(frameTime);
+
+    const GLFrameStats &gl = lastFrameGLStats();
+    glTotals.drawCalls        += gl.drawCalls;
+    glTotals.bufferBinds      += gl.bufferBinds;
+    glTotals.vertexArrayBinds += gl.vertexArrayBinds;
+    glTotals.textureBinds     += gl.textureBinds;
+    glTotals.programSwitches  += gl.programSwitches;
+    glTotals.uniformUploads   += gl.uniformUploads;
+    glTotals.bytesUploaded    += gl.bytesUploaded;
+
+    for (int phase = PHASE_UPDATE; phase < ALLOCATION_PHASE_COUNT; phase++) {
+        const AllocationStats &allocations = lastFrameAllocations((AllocationPhase) phase);
+        allocationTotals[phase].allocations += allocations.allocations;
+        allocationTotals[phase].bytes       += allocations.bytes;
+    }
+
+    return frameTimes.size() >= framesToRecord;
+}
+
+// Nearest-rank percentile of an already sorted list
+static double percentile(std::vector<double> const &sorted, double fraction) {
+    size_t rank = (size_t) std::ceil(fraction * sorted.size());
+    return sorted.at(std::max<size_t>(rank, 1) - 1);
+}
+
+void writeBenchmarkReport(std::string const &fileName) {
+    if (frameTimes.empty()) {
+        std::cerr << "No benchmark frames were recorded" << std::endl;
+        return;
+    }
+
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+
+    double count = (double) sorted.size();
+    double mean = 0;
+    for (double t : sorted) mean += t;
+    mean /= count;
+    double variance = 0;
+    for (double t : sorted) variance += (t - mean) * (t - mean);
+    double stddev = sorted.size() > 1 ? std::sqrt(variance / (count - 1)) : 0;
+
+    std::ofstream out(fileName);
+    if (out.fail()) {
+        std::cerr << "Could not write benchmark report to " << fileName << std::endl;
+        return;
+    }
+
+    out << "{\n";
+    out << fmt::format("    \"frames\": {},\n", sorted.size());
+    out << fmt::format("    \"warmup_frames\": {},\n", benchmarkWarmupFrames);
+    out << "    \"frame_time_ms\": {\n";
+    out << fmt::format("        \"mean\": {:.4f},\n", mean);
+    out << fmt::format("        \"stddev\": {:.4f},\n", stddev);
+    out << fmt::format("        \"min\": {:.4f},\n", sorted.front());
+    out << fmt::format("        \"median\": {:.4f},\n", percentile(sorted, 0.50));
+    out << fmt::format("        \"p95\": {:.4f},\n", percentile(sorted, 0.95));
+    out << fmt::format("        \"p99\": {:.4f},\n", percentile(sorted, 0.99));
+    out << fmt::format("        \"max\": {:.4f}\n", sorted.back());
+    out << "    }";
+    // Compare runs with --no-program-cache against warm runs to see what the cache saves
+    const ProgramSetupStats &setup = programSetupStats();
+    out << fmt::format(",\n    \"shader_setup_ms\": {:.3f}", setup.milliseconds);
+    out << fmt::format(",\n    \"shader_programs\": {{ \"total\": {}, \"from_cache\": {} }}", setup.programs, setup.loaded);
+    if (glStatsAvailable()) {
+        out << ",\n    \"gl_per_frame\": {\n";
+        out << fmt::format("        \"draw_calls\": {:.2f},\n", glTotals.drawCalls / count);
+        out << fmt::format("        \"buffer_binds\": {:.2f},\n", glTotals.bufferBinds / count);
+        out << fmt::format("        \"vertex_array_binds\": {:.2f},\n", glTotals.vertexArrayBinds / count);
+        out << fmt::format("        \"texture_binds\": {:.2f},\n", glTotals.textureBinds / count);
+        out << fmt::format("        \"program_switches\": {:.2f},\n", glTotals.programSwitches / count);
+        out << fmt::format("        \"uniform_uploads\": {:.2f},\n", glTotals.uniformUploads / count);
+        out << fmt::format("        \"bytes_uploaded\": {:.2f}\n", glTotals.bytesUploaded / count);
+        out << "    }";
+    }
+    if (allocationTrackingAvailable()) {
+        out << ",\n    \"allocations_per_frame\": {\n";
+        for (int phase = PHASE_UPDATE; phase < ALLOCATION_PHASE_COUNT; phase++) {
+            out << fmt::format("        \"{}\": {{ \"count\": {:.2f}, \"bytes\": {:.2f} }}{}\n",
+                               allocationPhaseName((AllocationPhase) phase),
+                               allocationTotals[phase].allocations / count,
+                               allocationTotals[phase].bytes / count,
+                               phase + 1 < ALLOCATION_PHASE_COUNT ? "," : "");
+        }
+        out << "    }";
+    }
+    out << "\n}\n";
+
+    std::cout << fmt::format("Benchmark: {} frames, mean {:.3f} ms, p99 {:.3f} ms. Report written to {}",
+                             sorted.size(), mean, percentile(sorted, 0.99), fileName) << std::endl;
+}
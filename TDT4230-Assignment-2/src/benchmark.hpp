@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+// Frames rendered before recording starts, so that shader compilation, driver
+// warm-up and first-use allocations do not end up in the statistics
+const unsigned int benchmarkWarmupFrames = 60;
+
+// Prepares recording of the given number of frames (after the warm-up frames)
+void startBenchmark(unsigned int frames);
+
+// Records the frame that just ended. Returns true once all frames have been recorded.
+bool recordBenchmarkFrame();
+
+// Writes frame time percentiles and per-frame GL counters as JSON
+void writeBenchmarkReport(std::string const &fileName);
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <chrono>
+#include <limits>
+#include <map>
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 #include <SFML/Audio/SoundBuffer.hpp>
@@ -9,6 +12,14 @@
 #include <utilities/mesh.h>
 #include <utilities/shapes.h>
 #include <utilities/glutils.h>
+#include <utilities/meshOptimizer.h>
+#include <utilities/meshRegistry.h>
+#include <utilities/levelOfDetail.h>
+#include <utilities/gpuBuffers.h>
+#include <utilities/sphereImpostors.h>
+#include <utilities/materials.h>
+#include <utilities/programCache.h>
+#include <utilities/textureStreamer.h>
 #include <utilities/imageLoader.hpp>
 #include <SFML/Audio/Sound.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -24,10 +35,7 @@
 #include "utilities/imageLoader.hpp"
 #include "utilities/glfont.h"
 
-enum KeyFrameAction {
-    BOTTOM, TOP
-};
-
+#include "keyFrames.hpp"
 #include <timestamps.h>
 
 double padPositionX = 0;
@@ -45,8 +53,9 @@ double ballRadius = 3.0f;
 
 // These are heap allocated, because they should not be initialised at the start of the program
 sf::SoundBuffer* buffer;
-Gloom::Shader* shader3D;
+Gloom::ShaderPermutations* shader3D;
 Gloom::Shader* shader2D;
+Gloom::ShaderPermutations* shaderImpostor;
 sf::Sound* sound;
 
 const glm::vec3 boxDimensions(180, 90, 90);
@@ -79,14 +88,48 @@ double lastMouseY = windowHeight / 2;
 
 #define SHADER_CAMERA_LOCATION 6
 glm::vec3 cameraPosition = glm::vec3(0, 2, -20);
+const float fieldOfView = glm::radians(80.0f);
+// Of the current window, for picking levels of detail
+float focalLength = focalLengthPixels(fieldOfView, float(windowHeight));
+// The camera, kept apart for the impostor shaders
+glm::mat4 viewMatrix;
+glm::mat4 projectionMatrix;
 
 #define LIGHT_SOURCES 1
 SceneNode *lightSources[LIGHT_SOURCES];
 
+// What a variant of the 3D programs is compiled for. The maps come from the
+// material of each draw, the rest from the scene.
+enum ShaderFeature {
+    SHADER_SURFACE_MAPS = MATERIAL_SURFACE_MAPS,
+    SHADER_NORMAL_MAPS  = MATERIAL_NORMAL_MAPS,
+    SHADER_BALL_SHADOW  = 4
+};
+// The bits above the features hold the light count class
+const unsigned int shaderLightClassShift = 3;
+// The features of every draw this run, set in initGame
+unsigned int sceneShaderKey = 0;
+
+// Looked up once per 3D program variant in initGame, so that no uniform names have to be built while rendering
+struct LightingLocations {
+    GLint lightPositions[LIGHT_SOURCES];
+    GLint lightColors[LIGHT_SOURCES];
+    GLint ballPosition;
+};
+std::map<unsigned int, LightingLocations> shader3DLocations;
+LightingLocations impostorLocations;
+
+// Collected while walking the scene, and drawn together after it
+std::vector<SphereInstance> sphereImpostors;
+
+// Sorted by the variant they need before drawing, so each is switched to once per frame
+struct DrawCall {
+    unsigned int shaderKey;
+    SceneNode *node;
+};
+std::vector<DrawCall> drawQueue;
+
 unsigned int charMapTextureID;
-unsigned int brickTextureID;
-unsigned int brickNormalID;
-unsigned int brickRoughnessID;
 
 void mouseCallback(GLFWwindow* window, double x, double y) {
     int windowWidth, windowHeight;
@@ -108,28 +151,60 @@ void mouseCallback(GLFWwindow* window, double x, double y) {
 }
 
 
-// @TODO: move into own file?
-unsigned int imageToTexture(PNGImage image) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    // Copy image into texture
-    glTexImage2D(GL_TEXTURE_2D,
-                 0, // Level of detail. 0 since we are only creating a single texture.
-                 GL_RGBA, // Internal format
-                 image.width, // Width
-                 image.height, // Height
-                 0, // Border
-                 GL_RGBA, // Input format the input data is stored in
-                 GL_UNSIGNED_BYTE, // Data and type per channel
-                 image.pixels.data()); // Image data
-
-    glGenerateMipmap(GL_TEXTURE_2D);
-    // Configure the sampling options for the texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    return textureID;
+static void attachGeometry(SceneNode *node, const GeometryBuffer &buffer) {
+    node->vertexArrayObjectID = buffer.vertexArrayObjectID;
+    node->vertexBufferID      = buffer.vertexBufferID;
+    node->indexBufferID       = buffer.indexBufferID;
+    node->vertexStride        = buffer.vertexStride;
+    node->VAOIndexCount       = buffer.indexCount;
+    node->VAOIndexType        = buffer.indexType;
+}
+
+// Draws the node with the mesh's levels of detail
+static void attachMesh(SceneNode *node, MeshHandle mesh) {
+    attachGeometry(node, meshGeometry(mesh));
+    node->mesh = mesh;
+    node->detailLevel = 0;
+}
+
+static LightingLocations lookUpLightingLocations(Gloom::Shader *shader) {
+    LightingLocations locations;
+    for (int i = 0; i < LIGHT_SOURCES; i++) {
+        auto prefix = fmt::format("light_sources[{}]", i);
+        locations.lightPositions[i] = shader->getUniformFromName(prefix + ".position");
+        locations.lightColors[i] = shader->getUniformFromName(prefix + ".color");
+    }
+    locations.ballPosition = shader->getUniformFromName("ball_position");
+    return locations;
+}
+
+// Light counts are rounded up to a power of two, so that a few variants cover
+// any number of lights. Lights past the count keep their default black colour.
+static unsigned int lightClassKey(unsigned int lights) {
+    unsigned int lightClass = 0;
+    while ((1u << lightClass) < lights) {
+        lightClass++;
+    }
+    return lightClass << shaderLightClassShift;
+}
+
+static std::string shaderDefines(unsigned int key) {
+    std::string defines = fmt::format("#define LIGHT_SOURCES {}\n", 1u << (key >> shaderLightClassShift));
+    if (key & SHADER_SURFACE_MAPS) defines += "#define SURFACE_MAPS\n";
+    if (key & SHADER_NORMAL_MAPS)  defines += "#define NORMAL_MAPS\n";
+    if (key & SHADER_BALL_SHADOW)  defines += "#define BALL_SHADOW\n";
+    return defines;
+}
+
+static void reportOptimization(const char *name, MeshHandle mesh) {
+    if (meshLoadedFromCache(mesh)) {
+        std::cout << fmt::format("Loaded    {:<6} from the mesh cache", name) << std::endl;
+        return;
+    }
+    const MeshOptimizationStats &stats = meshOptimizationStats(mesh);
+    std::cout << fmt::format("Optimised {:<6} vertices {:>5} -> {:>5}, ACMR {:.3f} -> {:.3f}",
+                             name, stats.verticesBefore, stats.verticesAfter,
+                             stats.acmrBefore, stats.acmrAfter) << std::endl;
 }
 
 void initGame(GLFWwindow* window, CommandLineOptions gameOptions) {
@@ -139,63 +214,91 @@ void initGame(GLFWwindow* window, CommandLineOptions gameOptions) {
     }
 
     options = gameOptions;
+    setTextureMemoryBudget(size_t(std::max(options.textureBudgetMiB, 0)) * 1024 * 1024);
+
+    // Created up front rather than when the game starts, to keep the frame loop free of allocations
+    if (options.enableMusic) {
+        sound = new sf::Sound();
+        sound->setBuffer(*buffer);
+    }
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
     glfwSetCursorPosCallback(window, mouseCallback);
 
-    shader3D = new Gloom::Shader();
-    shader3D->makeBasicShader("../res/shaders/simple.vert", "../res/shaders/simple.frag");
-    shader3D->activate();
+    if (!options.programCache) {
+        setProgramCacheDirectory("");
+    }
+
+    // Both 3D programs link in the shared lighting as a second fragment shader.
+    // Every variant a draw can pick is compiled here, rather than in the frame loop.
+    sceneShaderKey = lightClassKey(LIGHT_SOURCES) | (options.ballShadow ? SHADER_BALL_SHADOW : 0);
+    shader3D = new Gloom::ShaderPermutations({ "../res/shaders/simple.vert",
+                                               "../res/shaders/simple.frag",
+                                               "../res/shaders/lighting.frag" }, shaderDefines);
+    for (unsigned int maps = 0; maps <= (SHADER_SURFACE_MAPS | SHADER_NORMAL_MAPS); maps++) {
+        unsigned int key = sceneShaderKey | maps;
+        shader3DLocations[key] = lookUpLightingLocations(&shader3D->variant(key));
+    }
+
+    if (options.sphereImpostors) {
+        shaderImpostor = new Gloom::ShaderPermutations({ "../res/shaders/impostor.vert",
+                                                         "../res/shaders/impostor.frag",
+                                                         "../res/shaders/lighting.frag" }, shaderDefines);
+        impostorLocations = lookUpLightingLocations(&shaderImpostor->variant(sceneShaderKey));
+    }
 
     shader2D = new Gloom::Shader();
     shader2D->makeBasicShader("../res/shaders/2d.vert", "../res/shaders/2d.frag");
 
-    brickTextureID = imageToTexture(loadPNGFile("../res/textures/Brick03_col.png"));
-    brickNormalID = imageToTexture(loadPNGFile("../res/textures/Brick03_nrm.png"));
-    brickRoughnessID = imageToTexture(loadPNGFile("../res/textures/Brick03_rgh.png"));
+    const ProgramSetupStats &setup = programSetupStats();
+    std::cout << fmt::format("Set up {} shader programs in {:.1f} ms, {} of them from the program cache",
+                             setup.programs, setup.milliseconds, setup.loaded) << std::endl;
 
-    PNGImage charMap = loadPNGFile("../res/textures/charmap.png");
-    charMapTextureID = imageToTexture(charMap);
+    // Transparent until loaded, so the text simply appears
+    streamTexture("../res/textures/charmap.png", &charMapTextureID, glm::vec4(0, 0, 0, 0), TEXTURE_COLOR);
 
     Mesh helloMomText = generateTextGeometryBuffer("Press the left mouse button to start !", 39.0 / 29.0, 700.0);
-    unsigned int textVAO = generateBuffer(helloMomText);
+    GeometryBuffer textBuffer = generateBuffer(helloMomText);
     SceneNode *textNode = createSceneNode(GEOMETRY_2D);
-    textNode->vertexArrayObjectID = textVAO;
-    textNode->textureID = charMapTextureID;
-    textNode->VAOIndexCount = helloMomText.indices.size();
+    attachGeometry(textNode, textBuffer);
     textNode->position  = { 0, 0, 0 };
 
-    Mesh pad = cube(padDimensions, glm::vec2(30, 40), true);
-    Mesh box = cube(boxDimensions, glm::vec2(90), true, true);
-    Mesh sphere = generateSphere(1.0, 40, 40);
+    // Generated, optimised and uploaded once per set of parameters
+    MeshHandle padMesh  = acquireCube(padDimensions, glm::vec2(30, 40), true);
+    MeshHandle boxMesh  = acquireCube(boxDimensions, glm::vec2(90), true, true);
+    MeshHandle ballMesh = options.sphereImpostors ? 0 : acquireSphere(1.0, 40, 40);
 
-    // Fill buffers
-    unsigned int ballVAO = generateBuffer(sphere);
-    unsigned int boxVAO  = generateBuffer(box);
-    unsigned int padVAO  = generateBuffer(pad);
+    reportOptimization("pad", padMesh);
+    reportOptimization("box", boxMesh);
+    if (ballMesh != 0) {
+        reportOptimization("sphere", ballMesh);
+    }
 
     // Construct scene
     rootNode = createSceneNode(GEOMETRY);
     boxNode  = createSceneNode(NORMAL_MAPPED);
     padNode  = createSceneNode(GEOMETRY);
-    ballNode = createSceneNode(GEOMETRY);
+    ballNode = createSceneNode(options.sphereImpostors ? SPHERE_IMPOSTOR : GEOMETRY);
 
     rootNode->children.push_back(boxNode);
     rootNode->children.push_back(padNode);
     rootNode->children.push_back(ballNode);
     rootNode->children.push_back(textNode);
 
-    boxNode->vertexArrayObjectID  = boxVAO;
-    boxNode->VAOIndexCount        = box.indices.size();
-    boxNode->textureID = brickTextureID;
-    boxNode->textureNormalID = brickNormalID;
-    boxNode->roughnessID = brickRoughnessID;
+    attachMesh(boxNode, boxMesh);
+    // Plain grey, a flat normal and medium roughness until the maps are loaded
+    MaterialDescription brick;
+    brick.color = glm::vec4(0.5, 0.5, 0.5, 1);
+    brick.albedoFile = "../res/textures/Brick03_col.png";
+    brick.roughnessFile = "../res/textures/Brick03_rgh.png";
+    brick.normalFile = "../res/textures/Brick03_nrm.png";
+    boxNode->material = createMaterial(brick);
 
-    padNode->vertexArrayObjectID  = padVAO;
-    padNode->VAOIndexCount        = pad.indices.size();
+    attachMesh(padNode, padMesh);
 
-    ballNode->vertexArrayObjectID = ballVAO;
-    ballNode->VAOIndexCount       = sphere.indices.size();
+    if (ballMesh != 0) {
+        attachMesh(ballNode, ballMesh);
+    }
 
     // 2D Geometry root node
     // Add lights
@@ -234,6 +337,21 @@ void initGame(GLFWwindow* window, CommandLineOptions gameOptions) {
     std::cout << "Ready. Click to start!" << std::endl;
 }
 
+// Move and rotate various SceneNodes to match the game state
+static void placeSceneNodes() {
+    boxNode->position = { 0, -10, -80 };
+
+    ballNode->position = ballPosition;
+    ballNode->scale = glm::vec3(ballRadius);
+    ballNode->rotation = { 0, totalElapsedTime*2, 0 };
+
+    padNode->position  = {
+        boxNode->position.x - (boxDimensions.x/2) + (padDimensions.x/2) + (1 - padPositionX) * (boxDimensions.x - padDimensions.x),
+        boxNode->position.y - (boxDimensions.y/2) + (padDimensions.y/2),
+        boxNode->position.z - (boxDimensions.z/2) + (padDimensions.z/2) + (1 - padPositionZ) * (boxDimensions.z - padDimensions.z)
+    };
+}
+
 static void updateGameLogic(GLFWwindow *window) {
     double timeDelta = getTimeDeltaSeconds();
 
@@ -264,10 +382,8 @@ static void updateGameLogic(GLFWwindow *window) {
     }
 
     if(!hasStarted) {
-        if (mouseLeftPressed) {
+        if (mouseLeftPressed || options.benchmarkFrames > 0) {
             if (options.enableMusic) {
-                sound = new sf::Sound();
-                sound->setBuffer(*buffer);
                 sf::Time startTime = sf::seconds(debug_startTime);
                 sound->setPlayingOffset(startTime);
                 sound->play();
@@ -305,12 +421,7 @@ static void updateGameLogic(GLFWwindow *window) {
                 }
             }
             // Get the timing for the beat of the song
-            for (unsigned int i = currentKeyFrame; i < keyFrameTimeStamps.size(); i++) {
-                if (gameElapsedTime < keyFrameTimeStamps.at(i)) {
-                    continue;
-                }
-                currentKeyFrame = i;
-            }
+            currentKeyFrame = findKeyFrame(keyFrameTimeStamps, currentKeyFrame, gameElapsedTime);
 
             jumpedToNextFrame = currentKeyFrame != previousKeyFrame;
             previousKeyFrame = currentKeyFrame;
@@ -381,33 +492,17 @@ static void updateGameLogic(GLFWwindow *window) {
                     hasLost = true;
                     if (options.enableMusic) {
                         sound->stop();
-                        delete sound;
                     }
                 }
             }
         }
     }
 
-    // Move and rotate various SceneNodes
-    boxNode->position = { 0, -10, -80 };
-
-    ballNode->position = ballPosition;
-    ballNode->scale = glm::vec3(ballRadius);
-    ballNode->rotation = { 0, totalElapsedTime*2, 0 };
-
-    padNode->position  = {
-        boxNode->position.x - (boxDimensions.x/2) + (padDimensions.x/2) + (1 - padPositionX) * (boxDimensions.x - padDimensions.x),
-        boxNode->position.y - (boxDimensions.y/2) + (padDimensions.y/2),
-        boxNode->position.z - (boxDimensions.z/2) + (padDimensions.z/2) + (1 - padPositionZ) * (boxDimensions.z - padDimensions.z)
-    };
+    placeSceneNodes();
 }
 
-void updateFrame(GLFWwindow* window) {
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    updateGameLogic(window);
-
-    glm::mat4 projection = glm::perspective(glm::radians(80.0f), float(windowWidth) / float(windowHeight), 0.1f, 350.f);
+static void updateTransformations() {
+    glm::mat4 projection = glm::perspective(fieldOfView, float(windowWidth) / float(windowHeight), 0.1f, 350.f);
 
     // Some math to make the camera move in a nice way
     float lookRotation = -0.6 / (1 + exp(-5 * (padPositionX-0.5))) + 0.3;
@@ -417,63 +512,65 @@ void updateFrame(GLFWwindow* window) {
                     glm::translate(-cameraPosition);
 
     glm::mat4 VP = projection * cameraTransform;
+    viewMatrix = cameraTransform;
+    projectionMatrix = projection;
 
     glm::mat4 identity = glm::mat4(1);
     updateNodeTransformations(rootNode, identity, VP);
 }
 
-void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar, glm::mat4 VP) {
-    glm::mat4 transformationMatrix =
-              glm::translate(node->position)
-            * glm::translate(node->referencePoint)
-            * glm::rotate(node->rotation.y, glm::vec3(0,1,0))
-            * glm::rotate(node->rotation.x, glm::vec3(1,0,0))
-            * glm::rotate(node->rotation.z, glm::vec3(0,0,1))
-            * glm::scale(node->scale)
-            * glm::translate(-node->referencePoint);
+void updateFrame(GLFWwindow* window) {
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    node->modelMatrix = transformationThusFar * transformationMatrix;
-    node->currentTransformationMatrix = VP * node->modelMatrix;
-    node->normalMatrix = glm::mat3(glm::transpose(glm::inverse(node->modelMatrix)));
+    updateGameLogic(window);
+    updateTransformations();
+}
 
-    switch(node->nodeType) {
-        case GEOMETRY_2D: break;
-        case GEOMETRY: break;
-        case POINT_LIGHT:
-            node->lightPosition = glm::vec3(node->modelMatrix * glm::vec4(0, 0, 0, 1));
-            break;
-        case SPOT_LIGHT: {
-        } break;
-    }
+void applyScenePose(const ScenePose &pose) {
+    padPositionX = pose.padPositionX;
+    padPositionZ = pose.padPositionZ;
+    ballPosition = pose.ballPosition;
+    totalElapsedTime = pose.elapsedTime;
+    hasStarted = pose.hasStarted;
+    hasLost = false;
 
-    for(SceneNode* child : node->children) {
-        updateNodeTransformations(child, node->modelMatrix, VP);
-    }
+    placeSceneNodes();
+    updateTransformations();
 }
 
-
-void renderNode3D(SceneNode* node) {
+// Draws a node queued by renderNode3D, with its variant active
+static void drawNode3D(SceneNode* node) {
     glUniformMatrix4fv(3, 1, GL_FALSE, glm::value_ptr(node->currentTransformationMatrix));
     glUniformMatrix4fv(4, 1, GL_FALSE, glm::value_ptr(node->modelMatrix));
     glUniformMatrix3fv(5, 1, GL_FALSE, glm::value_ptr(node->normalMatrix));
 
-    /* Set normal mapped flag */
-    if (node->nodeType == NORMAL_MAPPED) {
-        glUniform1i(7, 1);
+    // Indexes the material table, whose textures are bound once for the pass
+    glUniform1i(7, node->material);
+
+    if (node->mesh != 0) {
+        const std::vector<MeshLevel> &levels = meshLevels(node->mesh);
+        const MeshBounds &bounds = meshBounds(node->mesh);
+        float pixelsPerUnit = pixelsPerModelUnit(bounds, node->modelMatrix, cameraPosition, focalLength);
+        node->detailLevel = selectDetailLevel(levels, pixelsPerUnit, node->detailLevel);
+        // The bounding sphere across, on screen
+        reportMaterialFootprint(node->material, pixelsPerUnit * glm::length(bounds.max - bounds.min));
+        const GeometryBuffer &geometry = levels[node->detailLevel].geometry;
+        bindGeometry(geometry.vertexArrayObjectID, geometry.vertexBufferID, geometry.vertexStride, geometry.indexBufferID);
+        glDrawElements(GL_TRIANGLES, geometry.indexCount, geometry.indexType, nullptr);
     } else {
-        glUniform1i(7, 0);
+        // Without bounds, it may fill the screen
+        reportMaterialFootprint(node->material, std::numeric_limits<float>::infinity());
+        bindGeometry(node->vertexArrayObjectID, node->vertexBufferID, node->vertexStride, node->indexBufferID);
+        glDrawElements(GL_TRIANGLES, node->VAOIndexCount, node->VAOIndexType, nullptr);
     }
+}
 
+void renderNode3D(SceneNode* node) {
     switch(node->nodeType) {
         case NORMAL_MAPPED:
-            glBindTextureUnit(0, node->textureID);
-            glBindTextureUnit(1, node->textureNormalID);
-            glBindTextureUnit(2, node->roughnessID);
-            /* Intentional fallthrough */
         case GEOMETRY:
-            if(node->vertexArrayObjectID != -1) {
-                glBindVertexArray(node->vertexArrayObjectID);
-                glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
+            if (node->mesh != 0 || node->vertexArrayObjectID != -1) {
+                drawQueue.push_back({ sceneShaderKey | materialLoadedMaps(node->material), node });
             }
             break;
         case GEOMETRY_2D: {
@@ -482,6 +579,11 @@ void renderNode3D(SceneNode* node) {
         } break;
         case SPOT_LIGHT: {
         } break;
+        case SPHERE_IMPOSTOR: {
+            glm::vec3 center(node->modelMatrix[3]);
+            float radius = glm::length(glm::vec3(node->modelMatrix[0]));
+            sphereImpostors.push_back({ center, radius });
+        } break;
     }
 
     for(SceneNode* child : node->children) {
@@ -489,35 +591,54 @@ void renderNode3D(SceneNode* node) {
     }
 }
 
-void render3D(SceneNode *root) {
-    shader3D->activate();
+// Uniforms of lighting.frag, for the active program
+static void uploadLighting(const LightingLocations &locations) {
     glUniform3fv(SHADER_CAMERA_LOCATION, 1, glm::value_ptr(cameraPosition));
 
     // Pass light positions to fragment shader
     for (int i = 0; i < LIGHT_SOURCES; i++) {
         SceneNode *node = lightSources[i];
-        auto prefix = fmt::format("light_sources[{}]", i);
-        // Position
-        auto location_position = shader3D->getUniformFromName(prefix + ".position");
-        glUniform3fv(location_position, 1, glm::value_ptr(node->lightPosition));
-        // Color
-        auto location_color = shader3D->getUniformFromName(prefix + ".color");
-        glUniform3fv(location_color, 1, glm::value_ptr(node->lightColor));
+        glUniform3fv(locations.lightPositions[i], 1, glm::value_ptr(node->lightPosition));
+        glUniform3fv(locations.lightColors[i], 1, glm::value_ptr(node->lightColor));
     }
 
     // Pass ball position to fragment shader
-    glUniform3fv(shader3D->getUniformFromName("ball_position"), 1, glm::value_ptr(ballNode->position));
-
+    glUniform3fv(locations.ballPosition, 1, glm::value_ptr(ballNode->position));
+}
 
+void render3D(SceneNode *root) {
+    drawQueue.clear();
+    sphereImpostors.clear();
     renderNode3D(root);
+
+    std::sort(drawQueue.begin(), drawQueue.end(), [](const DrawCall &a, const DrawCall &b) {
+        return a.shaderKey < b.shaderKey;
+    });
+    bindMaterials();
+    for (size_t i = 0; i < drawQueue.size(); i++) {
+        unsigned int key = drawQueue[i].shaderKey;
+        if (i == 0 || key != drawQueue[i - 1].shaderKey) {
+            shader3D->variant(key).activate();
+            uploadLighting(shader3DLocations[key]);
+        }
+        drawNode3D(drawQueue[i].node);
+    }
+
+    if (!sphereImpostors.empty()) {
+        shaderImpostor->variant(sceneShaderKey).activate();
+        uploadLighting(impostorLocations);
+        glUniformMatrix4fv(3, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+        glUniformMatrix4fv(4, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        drawSphereImpostors(sphereImpostors.data(), sphereImpostors.size());
+    }
 }
 
 void renderNode2D(SceneNode* node) {
     switch(node->nodeType) {
         case GEOMETRY_2D: {
             if ((!hasStarted || hasLost) && node->vertexArrayObjectID != -1) {
-                glBindVertexArray(node->vertexArrayObjectID);
-                glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
+                bindGeometry(node->vertexArrayObjectID, node->vertexBufferID, node->vertexStride, node->indexBufferID);
+                glDrawElements(GL_TRIANGLES, node->VAOIndexCount, node->VAOIndexType, nullptr);
             }
         default: break;
         }
@@ -551,7 +672,9 @@ void renderFrame(GLFWwindow* window) {
     int windowWidth, windowHeight;
     glfwGetWindowSize(window, &windowWidth, &windowHeight);
     glViewport(0, 0, windowWidth, windowHeight);
+    focalLength = focalLengthPixels(fieldOfView, float(windowHeight));
 
+    updateTextureStreaming();
     render3D(rootNode);
     render2D(rootNode);
 }
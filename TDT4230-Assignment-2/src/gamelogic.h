@@ -3,7 +3,20 @@
 #include <utilities/window.hpp>
 #include "sceneGraph.hpp"
 
-void updateNodeTransformations(SceneNode* node, glm::mat4 transformationThusFar, glm::mat4 VP);
+// A fixed game state, used to render reproducible frames
+struct ScenePose {
+    const char *name;
+    double padPositionX;   // 0..1, also steers the camera
+    double padPositionZ;   // 0..1, also steers the camera
+    glm::vec3 ballPosition;
+    double elapsedTime;    // Drives the ball's rotation
+    bool hasStarted;       // The start text is shown until the game has started
+};
+
 void initGame(GLFWwindow* window, CommandLineOptions options);
 void updateFrame(GLFWwindow* window);
 void renderFrame(GLFWwindow* window);
+
+// Puts the game into the given state and updates all transformations,
+// without advancing time or reading input
+void applyScenePose(const ScenePose &pose);
@@ -0,0 +1,207 @@
+#include "golden.hpp"
+#include "gamelogic.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <glad/glad.h>
+#include <fmt/format.h>
+#include <utilities/imageLoader.hpp>
+
+// Frames whose PSNR or SSIM falls below these count as changed
+const double minimumPSNR = 40.0;
+const double minimumSSIM = 0.98;
+
+const std::string goldenDirectory = "../res/golden/";
+const std::string diffDirectory = "golden-diff/";
+
+// Positions are in world space. The box spans x -90..90, y -55..35 and z -125..-35.
+static const ScenePose goldenPoses[] = {
+    // name                  pad X  pad Z  ball position            time   started
+    { "start_screen",        0.5,   0.5,   glm::vec3(  0, -49, -80), 0.0,  false },
+    { "ball_above_pad",      0.5,   0.5,   glm::vec3(  0, -10, -80), 1.0,  true  },
+    { "ball_top_left",       0.1,   0.9,   glm::vec3(-70,  28, -110), 2.5,  true  },
+    { "ball_near_camera",    0.8,   0.2,   glm::vec3( 40, -30, -45), 4.0,  true  },
+    { "pad_far_right_back",  1.0,   1.0,   glm::vec3( 75, -49, -105), 6.0,  true  },
+};
+
+struct ImageComparison {
+    double psnr;
+    double ssim;
+};
+
+// Both images are RGBA. Alpha is ignored, since it is not what ends up on screen.
+static ImageComparison compareImages(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b,
+                                     unsigned int width, unsigned int height) {
+    double squaredError = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = 0; c < 3; c++) {
+            double difference = double(a[i + c]) - double(b[i + c]);
+            squaredError += difference * difference;
+        }
+    }
+    double mse = squaredError / (3.0 * width * height);
+
+    ImageComparison result;
+    result.psnr = mse == 0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / mse);
+
+    // Mean SSIM of the luminance over non-overlapping 8x8 windows
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    const unsigned int window = 8;
+    double ssimSum = 0;
+    unsigned int windowCount = 0;
+    for (unsigned int y0 = 0; y0 + window <= height; y0 += window) {
+        for (unsigned int x0 = 0; x0 + window <= width; x0 += window) {
+            double sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+            for (unsigned int y = y0; y < y0 + window; y++) {
+                for (unsigned int x = x0; x < x0 + window; x++) {
+                    size_t i = 4 * (size_t(y) * width + x);
+                    double lumaA = 0.299 * a[i] + 0.587 * a[i + 1] + 0.114 * a[i + 2];
+                    double lumaB = 0.299 * b[i] + 0.587 * b[i + 1] + 0.114 * b[i + 2];
+                    sumA += lumaA;
+                    sumB += lumaB;
+                    sumAA += lumaA * lumaA;
+                    sumBB += lumaB * lumaB;
+                    sumAB += lumaA * lumaB;
+                }
+            }
+            double n = window * window;
+            double meanA = sumA / n, meanB = sumB / n;
+            double varianceA = sumAA / n - meanA * meanA;
+            double varianceB = sumBB / n - meanB * meanB;
+            double covariance = sumAB / n - meanA * meanB;
+            ssimSum += ((2 * meanA * meanB + c1) * (2 * covariance + c2))
+                     / ((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+            windowCount++;
+        }
+    }
+    result.ssim = windowCount > 0 ? ssimSum / windowCount : 1.0;
+    return result;
+}
+
+// Absolute difference per channel, amplified so that small changes are visible
+static std::vector<unsigned char> diffImage(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b) {
+    std::vector<unsigned char> diff(a.size());
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = 0; c < 3; c++) {
+            int difference = std::abs(int(a[i + c]) - int(b[i + c]));
+            diff[i + c] = (unsigned char) std::min(255, difference * 8);
+        }
+        diff[i + 3] = 255;
+    }
+    return diff;
+}
+
+// Images are kept bottom-up in memory, like OpenGL and loadPNGFile() use them
+static void writePNG(const std::string &fileName, const std::vector<unsigned char> &pixels,
+                     unsigned int width, unsigned int height) {
+    std::vector<unsigned char> flipped(pixels.size());
+    unsigned int rowBytes = 4 * width;
+    for (unsigned int row = 0; row < height; row++) {
+        std::copy(pixels.begin() + size_t(row) * rowBytes,
+                  pixels.begin() + size_t(row + 1) * rowBytes,
+                  flipped.begin() + size_t(height - 1 - row) * rowBytes);
+    }
+    unsigned error = lodepng::encode(fileName, flipped, width, height);
+    if (error) {
+        std::cerr << "Could not write " << fileName << ": " << lodepng_error_text(error) << std::endl;
+    }
+}
+
+int runGoldenImageTests(GLFWwindow* window, bool updateGoldens) {
+    const unsigned int width = windowWidth;
+    const unsigned int height = windowHeight;
+
+    // Golden images come from a reference machine. A checkout without any
+    // validates nothing, which must not look like a pass.
+    if (!updateGoldens) {
+        bool anyGolden = false;
+        for (const ScenePose &pose : goldenPoses) {
+            anyGolden = anyGolden || std::filesystem::exists(goldenDirectory + pose.name + ".png");
+        }
+        if (!anyGolden) {
+            std::cout << fmt::format("No golden images in {}. Run --update-golden on a reference machine and commit them.",
+                                     goldenDirectory) << std::endl;
+            return 1;
+        }
+    }
+
+    // Render offscreen, so the result does not depend on the window system
+    // or on the default framebuffer's multisampling
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Golden image framebuffer is incomplete" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::create_directories(updateGoldens ? goldenDirectory : diffDirectory);
+
+    unsigned int failures = 0;
+    std::vector<unsigned char> frame(4 * width * height);
+
+    for (const ScenePose &pose : goldenPoses) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        applyScenePose(pose);
+        renderFrame(window);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame.data());
+
+        std::string goldenFile = goldenDirectory + pose.name + ".png";
+        if (updateGoldens) {
+            writePNG(goldenFile, frame, width, height);
+            std::cout << fmt::format("{:<24} written to {}", pose.name, goldenFile) << std::endl;
+            continue;
+        }
+
+        if (!std::filesystem::exists(goldenFile)) {
+            std::cout << fmt::format("{:<24} MISSING  no golden image at {}, run with --update-golden", pose.name, goldenFile) << std::endl;
+            failures++;
+            continue;
+        }
+
+        PNGImage golden = loadPNGFile(goldenFile);
+        if (golden.width != width || golden.height != height) {
+            std::cout << fmt::format("{:<24} FAILED   golden image is {}x{}, frame is {}x{}",
+                                     pose.name, golden.width, golden.height, width, height) << std::endl;
+            failures++;
+            continue;
+        }
+
+        ImageComparison comparison = compareImages(frame, golden.pixels, width, height);
+        bool passed = comparison.psnr >= minimumPSNR && comparison.ssim >= minimumSSIM;
+        std::cout << fmt::format("{:<24} {:<8} PSNR {:6.2f} dB  SSIM {:.5f}",
+                                 pose.name, passed ? "ok" : "FAILED", comparison.psnr, comparison.ssim) << std::endl;
+
+        if (!passed) {
+            failures++;
+            writePNG(diffDirectory + pose.name + "_actual.png", frame, width, height);
+            writePNG(diffDirectory + pose.name + "_diff.png", diffImage(frame, golden.pixels), width, height);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+
+    if (failures > 0) {
+        std::cout << fmt::format("{} golden image(s) differ. Frames and diffs were written to {}", failures, diffDirectory) << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
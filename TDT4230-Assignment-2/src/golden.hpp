@@ -0,0 +1,12 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+// Renders a fixed set of scene poses into an offscreen framebuffer and compares
+// each frame against the PNGs in res/golden/. A frame passes if both its PSNR
+// and its mean SSIM stay above a threshold, which tolerates small driver
+// differences but catches visible changes. Failing frames and amplified diffs
+// are written to golden-diff/ in the working directory.
+// With updateGoldens set the frames replace the golden images instead.
+// Returns the process exit code.
+int runGoldenImageTests(GLFWwindow* window, bool updateGoldens);
@@ -0,0 +1,12 @@
+#include "keyFrames.hpp"
+
+unsigned int findKeyFrame(const std::vector<double> &timeStamps, unsigned int fromKeyFrame, double time) {
+    unsigned int keyFrame = fromKeyFrame;
+    for (unsigned int i = fromKeyFrame; i < timeStamps.size(); i++) {
+        if (time < timeStamps.at(i)) {
+            continue;
+        }
+        keyFrame = i;
+    }
+    return keyFrame;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+enum KeyFrameAction {
+    BOTTOM, TOP
+};
+
+// Returns the last keyframe at or after fromKeyFrame whose timestamp has been reached
+// at the given time, or fromKeyFrame if none has.
+unsigned int findKeyFrame(const std::vector<double> &timeStamps, unsigned int fromKeyFrame, double time);
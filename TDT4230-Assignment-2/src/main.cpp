@@ -1,6 +1,8 @@
 // Local headers
 #include "utilities/window.hpp"
 #include "program.hpp"
+#include "utilities/glstats.h"
+#include "utilities/allocationTracker.h"
 
 // System headers
 #include <glad/glad.h>
@@ -18,7 +20,7 @@ static void glfwErrorCallback(int error, const char *description)
 }
 
 
-GLFWwindow* initialise()
+GLFWwindow* initialise(bool visible)
 {
     // Initialise GLFW
     if (!glfwInit())
@@ -29,7 +31,7 @@ GLFWwindow* initialise()
 
     // Set core window options (adjust version numbers if needed)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Enable the GLFW runtime error callback function defined previously.
@@ -38,6 +40,7 @@ GLFWwindow* initialise()
     // Set additional window options
     glfwWindowHint(GLFW_RESIZABLE, windowResizable);
     glfwWindowHint(GLFW_SAMPLES, windowSamples);  // MSAA
+    glfwWindowHint(GLFW_VISIBLE, visible);
 
     // Create window using GLFW
     GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, windowTitle.c_str(), nullptr, nullptr);
@@ -53,6 +56,7 @@ GLFWwindow* initialise()
     // Let the window be the current OpenGL context and initialise glad
     glfwMakeContextCurrent(window);
     gladLoadGL();
+    installGLStats();
 
     // Print various OpenGL information to stdout
     printf("%s: %s\n", glGetString(GL_VENDOR), glGetString(GL_RENDERER));
@@ -70,6 +74,15 @@ int main(int argc, const char* argb[])
     const auto& showHelp       = parser.add<bool>("help", "Show this help message.", 'h', arrrgh::Optional, false);
     const auto& enableMusic    = parser.add<bool>("enable-music", "Play background music while the game is playing", 'm', arrrgh::Optional, false);
     const auto& enableAutoplay = parser.add<bool>("autoplay", "Let the game play itself automatically. Useful for testing.", 'a', arrrgh::Optional, false);
+    const auto& zeroAllocs     = parser.add<bool>("enforce-zero-alloc", "Abort if the frame loop allocates heap memory after warm-up.", 'z', arrrgh::Optional, false);
+    const auto& benchmark      = parser.add<int>("benchmark", "Autoplay the given number of frames, then write frame statistics as JSON and exit.", 'b', arrrgh::Optional, 0);
+    const auto& benchmarkOut   = parser.add<std::string>("benchmark-output", "File the benchmark statistics are written to.", 'o', arrrgh::Optional, "benchmark.json");
+    const auto& golden         = parser.add<bool>("golden", "Render fixed scenes in a hidden window and compare them against res/golden/.", 'g', arrrgh::Optional, false);
+    const auto& goldenUpdate   = parser.add<bool>("update-golden", "Render fixed scenes in a hidden window and overwrite res/golden/ with them.", 'u', arrrgh::Optional, false);
+    const auto& impostors      = parser.add<bool>("impostors", "Draw the ball as a ray cast sphere impostor instead of a triangle mesh.", 'i', arrrgh::Optional, false);
+    const auto& noShadows      = parser.add<bool>("no-shadows", "Leave out the ball's shadow, drawing with shader variants compiled without it.", 's', arrrgh::Optional, false);
+    const auto& noProgramCache = parser.add<bool>("no-program-cache", "Compile every shader program from source, neither reading nor writing the program binary cache.", 'p', arrrgh::Optional, false);
+    const auto& textureBudget  = parser.add<int>("texture-budget", "GPU memory, in MiB, that streamed textures may take before their finest levels are evicted.", 't', arrrgh::Optional, 256);
 
     // If you want to add more program arguments, define them here,
     // but do not request their value here (they have not been parsed yet at this point).
@@ -92,17 +105,42 @@ int main(int argc, const char* argb[])
     }
 
     CommandLineOptions options;
-    options.enableMusic    = enableMusic.value();
-    options.enableAutoplay = enableAutoplay.value();
+    options.enableMusic            = enableMusic.value();
+    options.enableAutoplay         = enableAutoplay.value();
+    options.enforceZeroAllocations = zeroAllocs.value();
+    options.benchmarkFrames        = benchmark.value();
+    options.benchmarkOutput        = benchmarkOut.value();
+    options.goldenCheck            = golden.value();
+    options.goldenUpdate           = goldenUpdate.value();
+    options.sphereImpostors        = impostors.value();
+    options.textureBudgetMiB       = textureBudget.value();
+    options.ballShadow             = !noShadows.value();
+    options.programCache           = !noProgramCache.value();
+
+    if (options.enforceZeroAllocations && !allocationTrackingAvailable())
+    {
+        std::cerr << "--enforce-zero-alloc needs a build with -DGLOWBOX_ALLOCATION_TRACKING=ON" << std::endl;
+    }
+
+    // Benchmarks should measure the same workload every run
+    if (options.benchmarkFrames > 0)
+    {
+        options.enableMusic    = false;
+        options.enableAutoplay = true;
+    }
+    if (options.goldenCheck || options.goldenUpdate)
+    {
+        options.enableMusic = false;
+    }
 
     // Initialise window using GLFW
-    GLFWwindow* window = initialise();
+    GLFWwindow* window = initialise(!options.goldenCheck && !options.goldenUpdate);
 
     // Run an OpenGL application using this window
-    runProgram(window, options);
+    int exitCode = runProgram(window, options);
 
     // Terminate GLFW (no need to call glfwDestroyWindow)
     glfwTerminate();
 
-    return EXIT_SUCCESS;
+    return exitCode;
 }
@@ -2,6 +2,8 @@
 #include "program.hpp"
 #include "utilities/window.hpp"
 #include "gamelogic.h"
+#include "benchmark.hpp"
+#include "golden.hpp"
 #include <glm/glm.hpp>
 // glm::translate, glm::rotate, glm::scale, glm::perspective
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,9 +15,16 @@
 #include <utilities/shader.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <utilities/timeutils.h>
+#include <utilities/glstats.h>
+#include <utilities/allocationTracker.h>
+#include <utilities/gpuBuffers.h>
+#include <utilities/meshRegistry.h>
+#include <utilities/sphereImpostors.h>
+#include <utilities/materials.h>
+#include <utilities/textureStreamer.h>
 
 
-void runProgram(GLFWwindow* window, CommandLineOptions options)
+int runProgram(GLFWwindow* window, CommandLineOptions options)
 {
     // Enable depth (Z) buffer (accept "closest" fragment)
     glEnable(GL_DEPTH_TEST);
@@ -36,22 +45,81 @@ void runProgram(GLFWwindow* window, CommandLineOptions options)
 
 	initGame(window, options);
 
+    if (options.goldenCheck || options.goldenUpdate)
+    {
+        // Golden frames must show the textures, not their placeholders
+        finishTextureStreaming();
+        int exitCode = runGoldenImageTests(window, options.goldenUpdate);
+        releaseTextureStreaming();
+        releaseMaterials();
+        releaseAllMeshes();
+        releaseSphereImpostors();
+        releaseAllGPUBuffers();
+        return exitCode;
+    }
+
+    if (options.benchmarkFrames > 0)
+    {
+        // Measure how fast frames can be produced, not the display refresh rate
+        glfwSwapInterval(0);
+        startBenchmark(options.benchmarkFrames);
+    }
+
+    trackFrameAllocations();
+    unsigned int frameCount = 0;
+    bool enforcingZeroAllocations = false;
+
     // Rendering Loop
     while (!glfwWindowShouldClose(window))
     {
+        // Heap allocations are only tolerated while everything is first used,
+        // which lasts until the warm-up is over and the textures have streamed in
+        if (options.enforceZeroAllocations && !enforcingZeroAllocations
+            && frameCount >= benchmarkWarmupFrames && textureStreamingIdle())
+        {
+            enforceNoFrameAllocations(true);
+            enforcingZeroAllocations = true;
+        }
+
 	    // Clear colour and depth buffers
 	    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        setAllocationPhase(PHASE_UPDATE);
         updateFrame(window);
+        setAllocationPhase(PHASE_RENDER);
         renderFrame(window);
 
         // Handle other events
+        setAllocationPhase(PHASE_EVENTS);
         glfwPollEvents();
         handleKeyboardInput(window);
 
         // Flip buffers
+        setAllocationPhase(PHASE_PRESENT);
         glfwSwapBuffers(window);
+
+        endAllocationFrame();
+        endGLStatsFrame();
+        frameCount++;
+        if (options.benchmarkFrames > 0 && recordBenchmarkFrame())
+        {
+            glfwSetWindowShouldClose(window, GL_TRUE);
+        }
     }
+
+    enforceNoFrameAllocations(false);
+
+    if (options.benchmarkFrames > 0)
+    {
+        writeBenchmarkReport(options.benchmarkOutput);
+    }
+
+    releaseTextureStreaming();
+    releaseMaterials();
+    releaseAllMeshes();
+    releaseSphereImpostors();
+    releaseAllGPUBuffers();
+    return EXIT_SUCCESS;
 }
 
 
@@ -1,5 +1,7 @@
 #include "sceneGraph.hpp"
 #include <iostream>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
 
 // Continiously increasing IDs
 static int nextID = 0;
@@ -25,6 +27,36 @@ int totalChildren(SceneNode* parent) {
 	return count;
 }
 
+void updateNodeTransformations(SceneNode* node, const glm::mat4 &transformationThusFar, const glm::mat4 &VP) {
+    glm::mat4 transformationMatrix =
+              glm::translate(node->position)
+            * glm::translate(node->referencePoint)
+            * glm::rotate(node->rotation.y, glm::vec3(0,1,0))
+            * glm::rotate(node->rotation.x, glm::vec3(1,0,0))
+            * glm::rotate(node->rotation.z, glm::vec3(0,0,1))
+            * glm::scale(node->scale)
+            * glm::translate(-node->referencePoint);
+
+    node->modelMatrix = transformationThusFar * transformationMatrix;
+    node->currentTransformationMatrix = VP * node->modelMatrix;
+    node->normalMatrix = glm::mat3(glm::transpose(glm::inverse(node->modelMatrix)));
+
+    switch(node->nodeType) {
+        case GEOMETRY_2D: break;
+        case GEOMETRY: break;
+        case POINT_LIGHT:
+            node->lightPosition = glm::vec3(node->modelMatrix * glm::vec4(0, 0, 0, 1));
+            break;
+        case SPOT_LIGHT: {
+        } break;
+        case SPHERE_IMPOSTOR: break;
+    }
+
+    for(SceneNode* child : node->children) {
+        updateNodeTransformations(child, node->modelMatrix, VP);
+    }
+}
+
 // Pretty prints the current values of a SceneNode instance to stdout
 void printNode(SceneNode* node) {
 	printf(
@@ -34,7 +66,7 @@ void printNode(SceneNode* node) {
 		"    Location: (%f, %f, %f)\n"
 		"    Reference point: (%f, %f, %f)\n"
 		"    VAO ID: %i\n"
-        "    Texture ID: %d\n"
+        "    Material: %u\n"
 		"    Light Node ID: %i\n"
 		"    Light position: (%f, %f, %f)\n"
 		"}\n",
@@ -42,7 +74,7 @@ void printNode(SceneNode* node) {
 		node->rotation.x, node->rotation.y, node->rotation.z,
 		node->position.x, node->position.y, node->position.z,
 		node->referencePoint.x, node->referencePoint.y, node->referencePoint.z, 
-		node->vertexArrayObjectID, node->textureID, node->lightNodeID, node->lightPosition.x,
+		node->vertexArrayObjectID, node->material, node->lightNodeID, node->lightPosition.x,
         node->lightPosition.y, node->lightPosition.z);
 }
 
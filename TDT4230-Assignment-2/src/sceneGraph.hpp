@@ -1,5 +1,6 @@
 #pragma once
 
+#include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -18,7 +19,8 @@ enum SceneNodeType {
     GEOMETRY_2D, 
     NORMAL_MAPPED, // Normal mapped 3D geometry
     POINT_LIGHT,
-    SPOT_LIGHT
+    SPOT_LIGHT,
+    SPHERE_IMPOSTOR // A sphere of radius 1, ray cast by the impostor shaders
 };
 
 struct SceneNode {
@@ -29,7 +31,14 @@ struct SceneNode {
 
         referencePoint = glm::vec3(0, 0, 0);
         vertexArrayObjectID = -1;
+        vertexBufferID = 0;
+        indexBufferID = 0;
+        vertexStride = 0;
         VAOIndexCount = 0;
+        VAOIndexType = GL_UNSIGNED_INT;
+        mesh = 0;
+        detailLevel = 0;
+        material = 0;
 
         nodeType = kind;
 	}
@@ -55,8 +64,20 @@ struct SceneNode {
 	glm::vec3 referencePoint;
 
 	// The ID of the VAO containing the "appearance" of this SceneNode.
+	// The VAO is shared by every node with the same vertex format, and the
+	// node's own buffers are attached to it before drawing.
 	int vertexArrayObjectID;
+	unsigned int vertexBufferID;
+	unsigned int indexBufferID;
+	int vertexStride;
 	unsigned int VAOIndexCount;
+	GLenum VAOIndexType;
+
+	// The MeshHandle from meshRegistry.h when the geometry came from there, 0 otherwise.
+	// Such nodes are drawn with the level of detail picked for their size on screen,
+	// and detailLevel is the level drawn last.
+	unsigned int mesh;
+	int detailLevel;
 
 	// Node type is used to determine how to handle the contents of a node
 	SceneNodeType nodeType;
@@ -69,14 +90,8 @@ struct SceneNode {
 
     glm::vec3 lightColor;
 
-    // The texture for this node
-    unsigned int textureID;
-
-    // Normal map 
-    unsigned int textureNormalID;
-
-    // Roughness texture
-    unsigned int roughnessID;
+    // The MaterialID from materials.h the node is drawn with
+    unsigned int material;
 };
 
 
@@ -84,5 +99,6 @@ SceneNode* createSceneNode(SceneNodeType nodeType);
 void addChild(SceneNode* parent, SceneNode* child);
 void printNode(SceneNode* node);
 int totalChildren(SceneNode* parent);
+void updateNodeTransformations(SceneNode* node, const glm::mat4 &transformationThusFar, const glm::mat4 &VP);
 
 // For more details, see SceneGraph.cpp.
@@ -0,0 +1,226 @@
+#include "allocationTracker.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+static std::atomic<unsigned long long> totalCount(0);
+static std::atomic<unsigned long long> totalBytes(0);
+static std::atomic<unsigned long long> liveBytes(0);
+static std::atomic<unsigned long long> peakBytes(0);
+
+static thread_local bool isFrameThread = false;
+static AllocationPhase currentPhase = PHASE_NONE;
+static bool enforcing = false;
+
+// Only written from the frame thread, so these need no synchronisation
+static AllocationStats currentFrame[ALLOCATION_PHASE_COUNT];
+static AllocationStats lastFrame[ALLOCATION_PHASE_COUNT];
+
+bool allocationTrackingAvailable() {
+#ifdef GLOWBOX_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char *allocationPhaseName(AllocationPhase phase) {
+    switch (phase) {
+        case PHASE_UPDATE:  return "update";
+        case PHASE_RENDER:  return "render";
+        case PHASE_EVENTS:  return "events";
+        case PHASE_PRESENT: return "present";
+        default:            return "none";
+    }
+}
+
+AllocationStats totalAllocations() {
+    AllocationStats stats;
+    stats.allocations = totalCount.load(std::memory_order_relaxed);
+    stats.bytes = totalBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+unsigned long long liveHeapBytes() {
+    return liveBytes.load(std::memory_order_relaxed);
+}
+
+unsigned long long peakHeapBytes() {
+    return peakBytes.load(std::memory_order_relaxed);
+}
+
+void resetPeakHeapBytes() {
+    peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void trackFrameAllocations() {
+    isFrameThread = true;
+}
+
+void setAllocationPhase(AllocationPhase phase) {
+    currentPhase = phase;
+}
+
+void endAllocationFrame() {
+    for (int phase = 0; phase < ALLOCATION_PHASE_COUNT; phase++) {
+        lastFrame[phase] = currentFrame[phase];
+        currentFrame[phase] = AllocationStats();
+    }
+    currentPhase = PHASE_NONE;
+}
+
+const AllocationStats &lastFrameAllocations(AllocationPhase phase) {
+    return lastFrame[phase];
+}
+
+void enforceNoFrameAllocations(bool enabled) {
+    enforcing = enabled;
+}
+
+#ifdef GLOWBOX_ALLOCATION_TRACKING
+
+// Every block starts with its size, so that frees can be subtracted from the
+// live bytes. Padded to keep the alignment malloc guarantees.
+static const std::size_t blockHeaderSize = alignof(std::max_align_t);
+static_assert(blockHeaderSize >= sizeof(std::size_t), "The block header must fit a size");
+
+static void recordAllocation(std::size_t size) {
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+    unsigned long long live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    unsigned long long peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+    if (!isFrameThread || currentPhase == PHASE_NONE) {
+        return;
+    }
+    if (enforcing) {
+        // fprintf rather than iostreams, which may allocate themselves
+        fprintf(stderr, "Heap allocation of %zu bytes during the %s phase of a frame\n",
+                size, allocationPhaseName(currentPhase));
+        std::abort();
+    }
+    currentFrame[currentPhase].allocations++;
+    currentFrame[currentPhase].bytes += size;
+}
+
+static void *allocate(std::size_t size) {
+    unsigned char *block = static_cast<unsigned char *>(std::malloc(blockHeaderSize + size));
+    if (block == nullptr) {
+        return nullptr;
+    }
+    recordAllocation(size);
+    *reinterpret_cast<std::size_t *>(block) = size;
+    return block + blockHeaderSize;
+}
+
+static void deallocate(void *pointer) {
+    if (pointer == nullptr) {
+        return;
+    }
+    unsigned char *block = static_cast<unsigned char *>(pointer) - blockHeaderSize;
+    liveBytes.fetch_sub(*reinterpret_cast<std::size_t *>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+// Over-aligned blocks start at the first suitably aligned address that leaves
+// room in front for a header, which records the size and where the block
+// malloc returned begins
+struct AlignedBlockHeader {
+    void *block;
+    std::size_t size;
+};
+
+static void *allocateAligned(std::size_t size, std::size_t alignment) {
+    if (alignment <= blockHeaderSize) {
+        return allocate(size);
+    }
+    unsigned char *block = static_cast<unsigned char *>(std::malloc(sizeof(AlignedBlockHeader) + alignment - 1 + size));
+    if (block == nullptr) {
+        return nullptr;
+    }
+    recordAllocation(size);
+    std::uintptr_t first = reinterpret_cast<std::uintptr_t>(block) + sizeof(AlignedBlockHeader);
+    unsigned char *pointer = block + (((first + alignment - 1) & ~std::uintptr_t(alignment - 1)) - reinterpret_cast<std::uintptr_t>(block));
+    AlignedBlockHeader header = { block, size };
+    std::memcpy(pointer - sizeof(header), &header, sizeof(header));
+    return pointer;
+}
+
+static void deallocateAligned(void *pointer, std::size_t alignment) {
+    if (alignment <= blockHeaderSize) {
+        deallocate(pointer);
+        return;
+    }
+    if (pointer == nullptr) {
+        return;
+    }
+    AlignedBlockHeader header;
+    std::memcpy(&header, static_cast<unsigned char *>(pointer) - sizeof(header), sizeof(header));
+    liveBytes.fetch_sub(header.size, std::memory_order_relaxed);
+    std::free(header.block);
+}
+
+void *operator new(std::size_t size) {
+    void *pointer = allocate(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](std::size_t size) {
+    void *pointer = allocate(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept { deallocate(pointer); }
+void operator delete[](void *pointer) noexcept { deallocate(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { deallocate(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { deallocate(pointer); }
+
+
+// Used for types declared with an alignment above that of std::max_align_t
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    void *pointer = allocateAligned(size, std::size_t(alignment));
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    void *pointer = allocateAligned(size, std::size_t(alignment));
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocateAligned(size, std::size_t(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocateAligned(size, std::size_t(alignment));
+}
+
+void operator delete(void *pointer, std::align_val_t alignment) noexcept { deallocateAligned(pointer, std::size_t(alignment)); }
+void operator delete[](void *pointer, std::align_val_t alignment) noexcept { deallocateAligned(pointer, std::size_t(alignment)); }
+void operator delete(void *pointer, std::size_t, std::align_val_t alignment) noexcept { deallocateAligned(pointer, std::size_t(alignment)); }
+void operator delete[](void *pointer, std::size_t, std::align_val_t alignment) noexcept { deallocateAligned(pointer, std::size_t(alignment)); }
+void operator delete(void *pointer, std::align_val_t alignment, const std::nothrow_t &) noexcept { deallocateAligned(pointer, std::size_t(alignment)); }
+void operator delete[](void *pointer, std::align_val_t alignment, const std::nothrow_t &) noexcept { deallocateAligned(pointer, std::size_t(alignment)); }
+
+#endif
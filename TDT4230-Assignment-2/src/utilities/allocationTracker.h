@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts heap allocations made through the global operator new, so that the
+// steady-state frame loop can be kept free of them. Only active when built with
+// -DGLOWBOX_ALLOCATION_TRACKING=ON (the default). Otherwise all counters stay at zero.
+
+// The part of a frame an allocation is attributed to
+enum AllocationPhase {
+    PHASE_NONE,    // Outside the frame loop. Not counted per frame and never enforced.
+    PHASE_UPDATE,  // updateFrame()
+    PHASE_RENDER,  // renderFrame()
+    PHASE_EVENTS,  // glfwPollEvents() and input handling
+    PHASE_PRESENT, // glfwSwapBuffers()
+    ALLOCATION_PHASE_COUNT
+};
+
+struct AllocationStats {
+    unsigned long long allocations = 0;
+    unsigned long long bytes = 0;
+};
+
+// True if operator new/delete were replaced by the tracking versions
+bool allocationTrackingAvailable();
+
+const char *allocationPhaseName(AllocationPhase phase);
+
+// Allocations made by any thread since the program started
+AllocationStats totalAllocations();
+
+// Bytes allocated through operator new and not yet freed, by all threads
+unsigned long long liveHeapBytes();
+
+// The highest liveHeapBytes() since the program started or the last reset
+unsigned long long peakHeapBytes();
+void resetPeakHeapBytes();
+
+// Per-frame counting only applies to the thread that called this (the render thread)
+void trackFrameAllocations();
+
+void setAllocationPhase(AllocationPhase phase);
+
+// Closes the current frame: its per-phase counters become available through
+// lastFrameAllocations() and the phase is reset to PHASE_NONE.
+void endAllocationFrame();
+
+const AllocationStats &lastFrameAllocations(AllocationPhase phase);
+
+// While enabled, any allocation on the frame thread outside PHASE_NONE prints
+// the offending phase and size, then aborts. Run under a debugger (make run-debug)
+// to get the backtrace of the offender.
+void enforceNoFrameAllocations(bool enabled);
@@ -0,0 +1,30 @@
+#include "cacheFile.h"
+
+#include <cstdio>
+#include <fstream>
+
+bool writeFileReplacing(const std::string &fileName, const std::function<void(std::ostream &out)> &write) {
+    std::string temporaryName = fileName + ".tmp";
+    {
+        std::ofstream out(temporaryName, std::ios::binary | std::ios::trunc);
+        write(out);
+        if (!out.good()) {
+            out.close();
+            std::remove(temporaryName.c_str());
+            return false;
+        }
+    }
+
+    // rename() replaces the file atomically on POSIX, so readers see either
+    // the old file or the new one. Elsewhere it may refuse to replace an
+    // existing file, which then has to be removed first.
+    if (std::rename(temporaryName.c_str(), fileName.c_str()) == 0) {
+        return true;
+    }
+    std::remove(fileName.c_str());
+    if (std::rename(temporaryName.c_str(), fileName.c_str()) == 0) {
+        return true;
+    }
+    std::remove(temporaryName.c_str());
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include "mappedFile.h"
+
+// What the mesh, texture and program caches have in common: keys that stay
+// the same between runs, headers that identify the file, and writes that
+// never leave half a file behind.
+//
+// Headers are written exactly as they are laid out in memory, so each cache
+// checks with a static_assert on its size that its header has no padding.
+
+// FNV-1a, which unlike std::hash gives the same value in every run and on every platform
+const std::uint64_t fnv1aBasis = 0xcbf29ce484222325ull;
+const std::uint64_t fnv1aPrime = 0x100000001b3ull;
+
+inline void fnv1a(std::uint64_t &hash, const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * fnv1aPrime;
+    }
+}
+
+// Mixes in a whole word in one step, which is not FNV-1a proper but much
+// faster for large inputs
+inline void fnv1aWord(std::uint64_t &hash, std::uint64_t value) {
+    hash = (hash ^ value) * fnv1aPrime;
+}
+
+// Fills in the fields every cache header starts with: char magic[8],
+// std::uint32_t version and std::uint64_t key.
+template <typename Header>
+void initCacheHeader(Header &header, const char (&magic)[8], std::uint32_t version, std::uint64_t key) {
+    static_assert(std::is_trivially_copyable<Header>::value, "Cache headers are copied as bytes");
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.key = key;
+}
+
+// Reads the header at the start of the file. Returns false if the file is too
+// short for one, or if it has another magic, version or key.
+template <typename Header>
+bool readCacheHeader(const MappedFile &file, const char (&magic)[8], std::uint32_t version, std::uint64_t key, Header &header) {
+    static_assert(std::is_trivially_copyable<Header>::value, "Cache headers are copied as bytes");
+    if (file.size() < sizeof(Header)) {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    return std::memcmp(header.magic, magic, sizeof(header.magic)) == 0
+        && header.version == version
+        && header.key == key;
+}
+
+// Writes the file through a temporary one, which then replaces it, so readers
+// never see half a file. write() fills in the contents; returns false if
+// writing or replacing failed.
+bool writeFileReplacing(const std::string &fileName, const std::function<void(std::ostream &out)> &write);
@@ -2,7 +2,7 @@
 #include "glfont.h"
 
 
-Mesh generateTextGeometryBuffer(std::string text, float characterHeightOverWidth, float totalTextWidth) {
+Mesh generateTextGeometryBuffer(const std::string &text, float characterHeightOverWidth, float totalTextWidth) {
 
     float characterWidth = totalTextWidth / float(text.length());
     float characterHeight = characterHeightOverWidth * characterWidth;
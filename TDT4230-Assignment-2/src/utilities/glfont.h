@@ -3,4 +3,4 @@
 #include <string>
 #include "mesh.h"
 
-Mesh generateTextGeometryBuffer(std::string text, float characterHeightOverWidth, float totalTextWidth);
\ No newline at end of file
+Mesh generateTextGeometryBuffer(const std::string &text, float characterHeightOverWidth, float totalTextWidth);
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include <glad/glad.h>
+#include "glstats.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <utility>
+#include <vector>
+
+static GLFrameStats currentFrame;
+static GLFrameStats lastFrame;
+
+bool glStatsAvailable() {
+#ifdef GLOWBOX_GL_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void endGLStatsFrame() {
+    lastFrame = currentFrame;
+    currentFrame = GLFrameStats();
+}
+
+const GLFrameStats &lastFrameGLStats() {
+    return lastFrame;
+}
+
+#ifdef GLOWBOX_GL_STATS
+
+enum GLCallKind {
+    DRAW,
+    BUFFER_BIND,
+    VERTEX_ARRAY_BIND,
+    TEXTURE_BIND,
+    PROGRAM_SWITCH,
+    UNIFORM,
+    // Uploads, named after the argument layout used to find the byte count
+    BUFFER_DATA,            // (target|buffer, size, data, ...)
+    BUFFER_SUB_DATA,        // (target|buffer, offset, size, data)
+    TEX_IMAGE_2D,           // (target, level, internalformat, w, h, border, format, type, data)
+    TEX_SUB_IMAGE_2D,       // (target|texture, level, x, y, w, h, format, type, data)
+    TEX_SUB_IMAGE_3D,       // (target|texture, level, x, y, z, w, h, d, format, type, data)
+    COMPRESSED_IMAGE_2D,    // (target, level, internalformat, w, h, border, size, data)
+    COMPRESSED_SUB_IMAGE_2D,// (target|texture, level, x, y, w, h, format, size, data)
+    COMPRESSED_SUB_IMAGE_3D // (target|texture, level, x, y, z, w, h, d, format, size, data)
+};
+
+// Sorted by function pointer, so a call can be classified with a binary search
+static std::vector<std::pair<void*, GLCallKind>> callKinds;
+
+static unsigned int bytesPerPixel(GLenum format, GLenum type) {
+    unsigned int components;
+    switch (format) {
+        case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: components = 1; break;
+        case GL_RG: case GL_RG_INTEGER: components = 2; break;
+        case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+        default: components = 4; break;
+    }
+    switch (type) {
+        case GL_UNSIGNED_BYTE: case GL_BYTE: return components;
+        case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return 2 * components;
+        case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: return 4 * components;
+        default: return 4; // Packed formats such as GL_UNSIGNED_INT_8_8_8_8
+    }
+}
+
+static unsigned long long uploadedBytes(GLCallKind kind, va_list args) {
+    // Skips over arguments that are passed as 32-bit integers (GLenum, GLint, GLuint, GLsizei)
+    #define SKIP_INTS(args, count) for (int i = 0; i < count; i++) va_arg(args, int)
+
+    switch (kind) {
+        case BUFFER_DATA: {
+            SKIP_INTS(args, 1);
+            GLsizeiptr size = va_arg(args, GLsizeiptr);
+            const void *data = va_arg(args, const void*);
+            return data != nullptr ? size : 0;
+        }
+        case BUFFER_SUB_DATA: {
+            SKIP_INTS(args, 1);
+            va_arg(args, GLintptr);
+            return va_arg(args, GLsizeiptr);
+        }
+        case TEX_IMAGE_2D: {
+            SKIP_INTS(args, 3);
+            GLsizei width = va_arg(args, GLsizei);
+            GLsizei height = va_arg(args, GLsizei);
+            SKIP_INTS(args, 1);
+            GLenum format = va_arg(args, GLenum);
+            GLenum type = va_arg(args, GLenum);
+            const void *data = va_arg(args, const void*);
+            return data != nullptr ? (unsigned long long) width * height * bytesPerPixel(format, type) : 0;
+        }
+        case TEX_SUB_IMAGE_2D: {
+            SKIP_INTS(args, 4);
+            GLsizei width = va_arg(args, GLsizei);
+            GLsizei height = va_arg(args, GLsizei);
+            GLenum format = va_arg(args, GLenum);
+            GLenum type = va_arg(args, GLenum);
+            return (unsigned long long) width * height * bytesPerPixel(format, type);
+        }
+        case TEX_SUB_IMAGE_3D: {
+            SKIP_INTS(args, 5);
+            GLsizei width = va_arg(args, GLsizei);
+            GLsizei height = va_arg(args, GLsizei);
+            GLsizei depth = va_arg(args, GLsizei);
+            GLenum format = va_arg(args, GLenum);
+            GLenum type = va_arg(args, GLenum);
+            return (unsigned long long) width * height * depth * bytesPerPixel(format, type);
+        }
+        case COMPRESSED_IMAGE_2D: {
+            SKIP_INTS(args, 6);
+            GLsizei size = va_arg(args, GLsizei);
+            const void *data = va_arg(args, const void*);
+            return data != nullptr ? size : 0;
+        }
+        case COMPRESSED_SUB_IMAGE_2D:
+            SKIP_INTS(args, 7);
+            return va_arg(args, GLsizei);
+        case COMPRESSED_SUB_IMAGE_3D:
+            SKIP_INTS(args, 9);
+            return va_arg(args, GLsizei);
+        default:
+            return 0;
+    }
+
+    #undef SKIP_INTS
+}
+
+static void countCall(const char *name, void *funcptr, int len_args, ...) {
+    (void) name;
+    (void) len_args;
+
+    auto entry = std::lower_bound(callKinds.begin(), callKinds.end(), funcptr,
+        [](const std::pair<void*, GLCallKind> &a, void *b) { return a.first < b; });
+    if (entry == callKinds.end() || entry->first != funcptr) {
+        return;
+    }
+
+    switch (entry->second) {
+        case DRAW: currentFrame.drawCalls++; break;
+        case BUFFER_BIND: currentFrame.bufferBinds++; break;
+        case VERTEX_ARRAY_BIND: currentFrame.vertexArrayBinds++; break;
+        case TEXTURE_BIND: currentFrame.textureBinds++; break;
+        case PROGRAM_SWITCH: currentFrame.programSwitches++; break;
+        case UNIFORM: currentFrame.uniformUploads++; break;
+        default: {
+            va_list args;
+            va_start(args, len_args);
+            currentFrame.bytesUploaded += uploadedBytes(entry->second, args);
+            va_end(args);
+        } break;
+    }
+}
+
+// Replaces glad's default post callback, which calls glGetError() after every
+// single GL call and would dominate the frame time we are trying to explain.
+static void ignoreCall(const char *, void *, int, ...) {}
+
+void installGLStats() {
+    #define COUNT(function, kind) callKinds.emplace_back(reinterpret_cast<void*>(function), kind)
+    #define COUNT_UNIFORM(suffix) \
+        COUNT(glUniform##suffix, UNIFORM); \
+        COUNT(glProgramUniform##suffix, UNIFORM)
+
+    COUNT(glDrawArrays, DRAW);
+    COUNT(glDrawArraysInstanced, DRAW);
+    COUNT(glDrawArraysInstancedBaseInstance, DRAW);
+    COUNT(glDrawElements, DRAW);
+    COUNT(glDrawElementsBaseVertex, DRAW);
+    COUNT(glDrawElementsInstanced, DRAW);
+    COUNT(glDrawElementsInstancedBaseVertex, DRAW);
+    COUNT(glDrawElementsInstancedBaseVertexBaseInstance, DRAW);
+    COUNT(glDrawRangeElements, DRAW);
+    COUNT(glMultiDrawArrays, DRAW);
+    COUNT(glMultiDrawElements, DRAW);
+    COUNT(glMultiDrawArraysIndirect, DRAW);
+    COUNT(glMultiDrawElementsIndirect, DRAW);
+
+    COUNT(glBindBuffer, BUFFER_BIND);
+    COUNT(glBindBufferBase, BUFFER_BIND);
+    COUNT(glBindBufferRange, BUFFER_BIND);
+    COUNT(glBindVertexBuffer, BUFFER_BIND);
+    COUNT(glVertexArrayVertexBuffer, BUFFER_BIND);
+    COUNT(glVertexArrayElementBuffer, BUFFER_BIND);
+    COUNT(glBindVertexArray, VERTEX_ARRAY_BIND);
+
+    COUNT(glBindTexture, TEXTURE_BIND);
+    COUNT(glBindTextureUnit, TEXTURE_BIND);
+    COUNT(glBindTextures, TEXTURE_BIND);
+    COUNT(glBindImageTexture, TEXTURE_BIND);
+
+    COUNT(glUseProgram, PROGRAM_SWITCH);
+
+    COUNT_UNIFORM(1f);  COUNT_UNIFORM(2f);  COUNT_UNIFORM(3f);  COUNT_UNIFORM(4f);
+    COUNT_UNIFORM(1i);  COUNT_UNIFORM(2i);  COUNT_UNIFORM(3i);  COUNT_UNIFORM(4i);
+    COUNT_UNIFORM(1ui); COUNT_UNIFORM(2ui); COUNT_UNIFORM(3ui); COUNT_UNIFORM(4ui);
+    COUNT_UNIFORM(1fv); COUNT_UNIFORM(2fv); COUNT_UNIFORM(3fv); COUNT_UNIFORM(4fv);
+    COUNT_UNIFORM(1iv); COUNT_UNIFORM(2iv); COUNT_UNIFORM(3iv); COUNT_UNIFORM(4iv);
+    COUNT_UNIFORM(Matrix3fv);
+    COUNT_UNIFORM(Matrix4fv);
+
+    COUNT(glBufferData, BUFFER_DATA);
+    COUNT(glNamedBufferData, BUFFER_DATA);
+    COUNT(glBufferStorage, BUFFER_DATA);
+    COUNT(glNamedBufferStorage, BUFFER_DATA);
+    COUNT(glBufferSubData, BUFFER_SUB_DATA);
+    COUNT(glNamedBufferSubData, BUFFER_SUB_DATA);
+    COUNT(glTexImage2D, TEX_IMAGE_2D);
+    COUNT(glTexSubImage2D, TEX_SUB_IMAGE_2D);
+    COUNT(glTextureSubImage2D, TEX_SUB_IMAGE_2D);
+    COUNT(glTexSubImage3D, TEX_SUB_IMAGE_3D);
+    COUNT(glTextureSubImage3D, TEX_SUB_IMAGE_3D);
+    COUNT(glCompressedTexImage2D, COMPRESSED_IMAGE_2D);
+    COUNT(glCompressedTexSubImage2D, COMPRESSED_SUB_IMAGE_2D);
+    COUNT(glCompressedTextureSubImage2D, COMPRESSED_SUB_IMAGE_2D);
+    COUNT(glCompressedTexSubImage3D, COMPRESSED_SUB_IMAGE_3D);
+    COUNT(glCompressedTextureSubImage3D, COMPRESSED_SUB_IMAGE_3D);
+
+    #undef COUNT_UNIFORM
+    #undef COUNT
+
+    std::sort(callKinds.begin(), callKinds.end());
+
+    glad_set_pre_callback(countCall);
+    glad_set_post_callback(ignoreCall);
+}
+
+#else
+
+void installGLStats() {}
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+// Per-frame counters of the GL calls that matter for render walk performance.
+// Only populated when built with -DGLOWBOX_GL_STATS=ON, which routes every GL
+// call through glad's debug wrappers. Otherwise all counters stay at zero.
+struct GLFrameStats {
+    unsigned int drawCalls = 0;
+    unsigned int bufferBinds = 0;
+    unsigned int vertexArrayBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int programSwitches = 0;
+    unsigned int uniformUploads = 0;
+    unsigned long long bytesUploaded = 0;
+};
+
+// True if the counters were compiled in
+bool glStatsAvailable();
+
+// Hooks the glad debug callbacks. Must be called after gladLoadGL().
+void installGLStats();
+
+// Closes the current frame: its counters become available through
+// lastFrameGLStats() and counting starts over from zero.
+void endGLStatsFrame();
+
+const GLFrameStats &lastFrameGLStats();
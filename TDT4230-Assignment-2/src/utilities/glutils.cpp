@@ -1,92 +1,149 @@
 #include <glad/glad.h>
 #include <program.hpp>
 #include "glutils.h"
+#include "vertexLayout.hpp"
+#include "tangentSpace.h"
+#include "gpuBuffers.h"
 #include <vector>
+#include <cmath>
+#include <glm/gtc/quaternion.hpp>
 
 
 
-/* Source from http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-13-normal-mapping/ */
-void computeTangentBasis(
-    // inputs
-    std::vector<glm::vec3> &vertices,
-    std::vector<glm::vec2> &uvs,
-    // This function took in the normals, but apparently it was unused ?
-    // outputs
-    std::vector<glm::vec3> &tangents,
-    std::vector<glm::vec3> &bitangents
-) {
-    for (size_t i=0; i<vertices.size(); i+=3) {
-        // Shortcuts for vertices
-        glm::vec3 & v0 = vertices[i+0];
-        glm::vec3 & v1 = vertices[i+1];
-        glm::vec3 & v2 = vertices[i+2];
-
-        // Shortcuts for UVs
-        glm::vec2 & uv0 = uvs[i+0];
-        glm::vec2 & uv1 = uvs[i+1];
-        glm::vec2 & uv2 = uvs[i+2];
-
-        // Edges of the triangle : position delta
-        glm::vec3 deltaPos1 = v1-v0;
-        glm::vec3 deltaPos2 = v2-v0;
-
-        // UV delta
-        glm::vec2 deltaUV1 = uv1-uv0;
-        glm::vec2 deltaUV2 = uv2-uv0;
-
-        float r = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
-        glm::vec3 tangent = (deltaPos1 * deltaUV2.y   - deltaPos2 * deltaUV1.y)*r;
-        glm::vec3 bitangent = (deltaPos2 * deltaUV1.x   - deltaPos1 * deltaUV2.x)*r;
-        
-        // Set the same tangent for all three vertices of the triangle.
-        // They will be merged later, in vboindexer.cpp
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-
-        // Same thing for bitangents
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
+glm::vec4 tangentFrameQuaternion(glm::vec3 normal, glm::vec4 tangent) {
+    glm::vec3 n = glm::normalize(normal);
+
+    // Gram-Schmidt, in case the tangent was not made orthogonal to this normal.
+    // Without a usable tangent any direction perpendicular to the normal will do.
+    glm::vec3 t = glm::vec3(tangent) - n * glm::dot(n, glm::vec3(tangent));
+    if (!(glm::dot(t, t) > 1e-12f)) {
+        t = glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0));
+    }
+    t = glm::normalize(t);
+    glm::vec3 b = glm::cross(n, t);
+
+    glm::quat q = glm::quat_cast(glm::mat3(t, b, n));
+    glm::vec4 result = glm::normalize(glm::vec4(q.x, q.y, q.z, q.w));
+
+    // q and -q are the same rotation, which frees the sign of w to store the handedness.
+    // w must not round to zero when packed, or its sign would be lost.
+    if (result.w < 0) {
+        result = -result;
+    }
+    const float minimumW = 1.0f / 32767.0f;
+    if (result.w < minimumW) {
+        float scale = std::sqrt(1.0f - minimumW * minimumW);
+        result = glm::vec4(glm::vec3(result) * scale, minimumW);
     }
+    if (tangent.w < 0) {
+        result = -result;
+    }
+    return result;
+}
 
+// Sizes the packed vertex data for count vertices of the layout, and returns it as vertices to fill in
+template <class Layout>
+static typename Layout::Vertex *packedVertices(PackedMesh &packed, size_t count) {
+    packed.vertexFormat = &Layout::setupAttributes;
+    packed.vertexStride = Layout::stride;
+    packed.vertexData.resize(count * Layout::stride);
+    return reinterpret_cast<typename Layout::Vertex *>(packed.vertexData.data());
+}
+
+template <class Index>
+static void packIndices(const std::vector<unsigned int> &indices, std::vector<unsigned char> &indexData) {
+    indexData.resize(indices.size() * sizeof(Index));
+    Index *narrowed = reinterpret_cast<Index *>(indexData.data());
+    for (size_t i = 0; i < indices.size(); i++) {
+        narrowed[i] = (Index) indices[i];
+    }
 }
 
-template <class T>
-unsigned int generateAttribute(int id, int elementsPerEntry, std::vector<T> data, bool normalize) {
-    unsigned int bufferID;
-    glGenBuffers(1, &bufferID);
-    glBindBuffer(GL_ARRAY_BUFFER, bufferID);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(T), data.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(id, elementsPerEntry, GL_FLOAT, normalize ? GL_TRUE : GL_FALSE, sizeof(T), 0);
-    glEnableVertexAttribArray(id);
-    return bufferID;
+
+unsigned int indexTypeFor(size_t vertexCount) {
+    if (vertexCount <= 0x100) {
+        return GL_UNSIGNED_BYTE;
+    }
+    if (vertexCount <= 0x10000) {
+        return GL_UNSIGNED_SHORT;
+    }
+    return GL_UNSIGNED_INT;
 }
 
 
-unsigned int generateBuffer(Mesh &mesh) {
-    unsigned int vaoID;
-    glGenVertexArrays(1, &vaoID);
-    glBindVertexArray(vaoID);
+PackedMesh packMesh(const Mesh &mesh) {
+    PackedMesh packed;
+    size_t vertexCount = mesh.vertices.size();
+    bool hasTextureCoordinates = mesh.textureCoordinates.size() > 0;
 
-    generateAttribute(0, 3, mesh.vertices, false);
     if (mesh.normals.size() > 0) {
-        generateAttribute(1, 3, mesh.normals, true);
+        std::vector<glm::vec4> tangents(hasTextureCoordinates ? vertexCount : 0);
+        if (hasTextureCoordinates) {
+            generateTangents(mesh, tangents.data());
+        }
+
+        LitVertexLayout::Vertex *vertices = packedVertices<LitVertexLayout>(packed, vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            LitVertexLayout::Vertex &vertex = vertices[i];
+            vertex.set<LIT_POSITION>(mesh.vertices[i]);
+            vertex.set<LIT_NORMAL>(mesh.normals[i]);
+            if (hasTextureCoordinates) {
+                vertex.set<LIT_TEXTURE_COORDINATES>(mesh.textureCoordinates[i]);
+                vertex.set<LIT_TANGENT_FRAME>(tangentFrameQuaternion(mesh.normals[i], tangents[i]));
+            } else {
+                vertex.set<LIT_TEXTURE_COORDINATES>(glm::vec2(0));
+                vertex.set<LIT_TANGENT_FRAME>(tangentFrameQuaternion(mesh.normals[i], glm::vec4(0, 0, 0, 1)));
+            }
+        }
+    } else {
+        UnlitVertexLayout::Vertex *vertices = packedVertices<UnlitVertexLayout>(packed, vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            vertices[i].set<UNLIT_POSITION>(mesh.vertices[i]);
+            vertices[i].set<UNLIT_TEXTURE_COORDINATES>(hasTextureCoordinates ? mesh.textureCoordinates[i] : glm::vec2(0));
+        }
+    }
+
+    packed.bounds = { glm::vec3(0), glm::vec3(0) };
+    if (vertexCount > 0) {
+        packed.bounds = { mesh.vertices[0], mesh.vertices[0] };
+        for (const glm::vec3 &vertex : mesh.vertices) {
+            packed.bounds.min = glm::min(packed.bounds.min, vertex);
+            packed.bounds.max = glm::max(packed.bounds.max, vertex);
+        }
     }
-    if (mesh.textureCoordinates.size() > 0) {
-        generateAttribute(2, 2, mesh.textureCoordinates, false);
-
-        std::vector<glm::vec3> tangents;
-        std::vector<glm::vec3> bitangents;
-        computeTangentBasis(mesh.vertices, mesh.textureCoordinates, tangents, bitangents);
-        generateAttribute(3, 3, tangents, true);
-        generateAttribute(4, 3, bitangents, true);
+
+    packed.indexCount = (unsigned int) mesh.indices.size();
+    packed.indexType = indexTypeFor(vertexCount);
+    switch (packed.indexType) {
+        case GL_UNSIGNED_BYTE:  packIndices<GLubyte>(mesh.indices, packed.indexData);  break;
+        case GL_UNSIGNED_SHORT: packIndices<GLushort>(mesh.indices, packed.indexData); break;
+        default:                packIndices<GLuint>(mesh.indices, packed.indexData);   break;
     }
+    return packed;
+}
 
-    unsigned int indexBufferID;
-    glGenBuffers(1, &indexBufferID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+GeometryBuffer uploadMesh(const void *vertexData, size_t vertexDataSize, VertexFormatSetup vertexFormat, int vertexStride,
+                          const void *indexData, size_t indexDataSize, unsigned int indexCount, unsigned int indexType) {
+    GeometryBuffer buffer;
+    buffer.vertexArrayObjectID = vertexArrayForFormat(vertexFormat);
+    buffer.vertexBufferID = createStaticBuffer(vertexData, vertexDataSize);
+    buffer.vertexStride = vertexStride;
+    buffer.indexBufferID = createStaticBuffer(indexData, indexDataSize);
+    buffer.indexCount = indexCount;
+    buffer.indexType = indexType;
+    return buffer;
+}
+
+GeometryBuffer generateBuffer(const Mesh &mesh) {
+    PackedMesh packed = packMesh(mesh);
+    return uploadMesh(packed.vertexData.data(), packed.vertexData.size(), packed.vertexFormat, packed.vertexStride,
+                      packed.indexData.data(), packed.indexData.size(), packed.indexCount, packed.indexType);
+}
 
-    return vaoID;
+void releaseGeometryBuffer(GeometryBuffer &buffer) {
+    releaseBuffer(buffer.vertexBufferID);
+    releaseBuffer(buffer.indexBufferID);
+    buffer.vertexBufferID = 0;
+    buffer.indexBufferID = 0;
+    buffer.indexCount = 0;
 }
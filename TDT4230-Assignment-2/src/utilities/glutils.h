@@ -1,5 +1,55 @@
 #pragma once
 
 #include "mesh.h"
+#include "gpuBuffers.h"
 
-unsigned int generateBuffer(Mesh &mesh);
\ No newline at end of file
+// A mesh uploaded by generateBuffer() and what is needed to draw it.
+// The VAO is shared with all meshes of the same vertex format, see bindGeometry().
+struct GeometryBuffer {
+    unsigned int vertexArrayObjectID;
+    unsigned int vertexBufferID;
+    unsigned int indexBufferID;
+    int vertexStride;
+    unsigned int indexCount;
+    unsigned int indexType; // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+};
+
+// Axis-aligned box around a mesh's vertices, in model space
+struct MeshBounds {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// A mesh in the exact byte layout the GPU reads it in
+struct PackedMesh {
+    std::vector<unsigned char> vertexData;
+    std::vector<unsigned char> indexData;
+    VertexFormatSetup vertexFormat;
+    int vertexStride;
+    unsigned int indexCount;
+    unsigned int indexType;
+    MeshBounds bounds;
+};
+
+// Interleaves and packs the vertices (computing tangents if the mesh has normals
+// and texture coordinates), and narrows the indices to indexTypeFor() the vertex count.
+// Allocates the same number of times whatever the size of the mesh.
+PackedMesh packMesh(const Mesh &mesh);
+
+// Uploads packed data straight from wherever it is, e.g. a PackedMesh or a mapped file
+GeometryBuffer uploadMesh(const void *vertexData, size_t vertexDataSize, VertexFormatSetup vertexFormat, int vertexStride,
+                          const void *indexData, size_t indexDataSize, unsigned int indexCount, unsigned int indexType);
+
+// packMesh() followed by uploadMesh()
+GeometryBuffer generateBuffer(const Mesh &mesh);
+
+// Frees the mesh's buffers. The shared VAO stays.
+void releaseGeometryBuffer(GeometryBuffer &buffer);
+
+// The smallest index type that can address vertexCount vertices
+unsigned int indexTypeFor(size_t vertexCount);
+
+// Orthonormalises the frame around the normal and returns it as a quaternion
+// (x, y, z, w). tangent.w is the handedness as produced by generateTangents(),
+// and the quaternion's w gets the same sign.
+glm::vec4 tangentFrameQuaternion(glm::vec3 normal, glm::vec4 tangent);
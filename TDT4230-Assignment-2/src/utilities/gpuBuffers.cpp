@@ -0,0 +1,117 @@
+#include "gpuBuffers.h"
+
+#include <algorithm>
+#include <vector>
+
+// Vertex buffers of every format are attached to binding index 0
+static const GLuint vertexBufferBinding = 0;
+
+struct SharedVertexArray {
+    VertexFormatSetup setup;
+    GLuint vertexArray;
+    // What is currently attached, to skip redundant calls
+    GLuint vertexBuffer;
+    GLsizei vertexStride;
+    GLuint indexBuffer;
+};
+
+static std::vector<GLuint> liveBuffers;
+static std::vector<SharedVertexArray> sharedVertexArrays;
+static GLuint boundVertexArray = 0;
+
+GLuint createStaticBuffer(const void *data, size_t size) {
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    // Zero-sized storage is an error, but empty meshes still want a valid name.
+    // Their one byte is left undefined rather than read from past the end of data.
+    glNamedBufferStorage(buffer, std::max<size_t>(size, 1), size == 0 ? nullptr : data, 0);
+    liveBuffers.push_back(buffer);
+    return buffer;
+}
+
+GLuint createDynamicBuffer(size_t size) {
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, std::max<size_t>(size, 1), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    liveBuffers.push_back(buffer);
+    return buffer;
+}
+
+GLuint createPersistentBuffer(size_t size, void **mapping) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, std::max<size_t>(size, 1), nullptr, flags);
+    *mapping = glMapNamedBufferRange(buffer, 0, std::max<size_t>(size, 1), flags);
+    liveBuffers.push_back(buffer);
+    return buffer;
+}
+
+void releaseBuffer(GLuint buffer) {
+    auto found = std::find(liveBuffers.begin(), liveBuffers.end(), buffer);
+    if (found == liveBuffers.end()) {
+        return;
+    }
+    liveBuffers.erase(found);
+
+    // Deleting a buffer detaches it from the VAOs, forget that it was attached
+    for (SharedVertexArray &shared : sharedVertexArrays) {
+        if (shared.vertexBuffer == buffer) shared.vertexBuffer = 0;
+        if (shared.indexBuffer == buffer) shared.indexBuffer = 0;
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+GLuint vertexArrayForFormat(VertexFormatSetup setup) {
+    for (const SharedVertexArray &shared : sharedVertexArrays) {
+        if (shared.setup == setup) {
+            return shared.vertexArray;
+        }
+    }
+
+    GLuint vertexArray;
+    glCreateVertexArrays(1, &vertexArray);
+    setup(vertexArray, vertexBufferBinding);
+    sharedVertexArrays.push_back({ setup, vertexArray, 0, 0, 0 });
+    return vertexArray;
+}
+
+void bindGeometry(GLuint vertexArray, GLuint vertexBuffer, GLsizei vertexStride, GLuint indexBuffer) {
+    for (SharedVertexArray &shared : sharedVertexArrays) {
+        if (shared.vertexArray != vertexArray) {
+            continue;
+        }
+        if (shared.vertexBuffer != vertexBuffer || shared.vertexStride != vertexStride) {
+            glVertexArrayVertexBuffer(vertexArray, vertexBufferBinding, vertexBuffer, 0, vertexStride);
+            shared.vertexBuffer = vertexBuffer;
+            shared.vertexStride = vertexStride;
+        }
+        if (shared.indexBuffer != indexBuffer) {
+            glVertexArrayElementBuffer(vertexArray, indexBuffer);
+            shared.indexBuffer = indexBuffer;
+        }
+        break;
+    }
+
+    if (boundVertexArray != vertexArray) {
+        glBindVertexArray(vertexArray);
+        boundVertexArray = vertexArray;
+    }
+}
+
+size_t liveBufferCount() {
+    return liveBuffers.size();
+}
+
+void releaseAllGPUBuffers() {
+    if (!liveBuffers.empty()) {
+        glDeleteBuffers((GLsizei) liveBuffers.size(), liveBuffers.data());
+    }
+    for (const SharedVertexArray &shared : sharedVertexArrays) {
+        glDeleteVertexArrays(1, &shared.vertexArray);
+    }
+    liveBuffers.clear();
+    sharedVertexArrays.clear();
+    glBindVertexArray(0);
+    boundVertexArray = 0;
+}
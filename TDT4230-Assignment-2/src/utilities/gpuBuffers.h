@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+
+// Buffers and vertex arrays created through direct state access (GL 4.5).
+// Every handle is tracked, so everything still alive can be released before
+// the context goes away.
+
+// An immutable buffer holding the given data. Static data cannot be changed
+// afterwards, which lets the driver place it wherever the GPU reads it fastest.
+GLuint createStaticBuffer(const void *data, size_t size);
+
+// An immutable buffer of the given size whose contents are replaced with
+// glNamedBufferSubData(), for data that changes every frame
+GLuint createDynamicBuffer(size_t size);
+
+// An immutable buffer that stays mapped for writing until it is released.
+// Writes through *mapping are visible to commands issued after them, but the
+// caller must fence commands that read the buffer before overwriting it.
+GLuint createPersistentBuffer(size_t size, void **mapping);
+
+void releaseBuffer(GLuint buffer);
+
+// Sets up the attribute formats of a VAO for buffers bound to the given binding index
+typedef void (*VertexFormatSetup)(GLuint vertexArray, GLuint bindingIndex);
+
+// The VAO shared by all meshes whose vertices are described by setup,
+// created on first use. Meshes attach their buffers with bindGeometry().
+GLuint vertexArrayForFormat(VertexFormatSetup setup);
+
+template <class Layout>
+GLuint vertexArrayFor() {
+    return vertexArrayForFormat(&Layout::setupAttributes);
+}
+
+// Binds the shared VAO with the given vertex and index buffers attached.
+// Binds and attachments that are already in place are skipped, so VAOs must
+// only be bound through this function.
+void bindGeometry(GLuint vertexArray, GLuint vertexBuffer, GLsizei vertexStride, GLuint indexBuffer);
+
+// Number of buffers currently alive
+size_t liveBufferCount();
+
+// Deletes every buffer and shared VAO that is still alive
+void releaseAllGPUBuffers();
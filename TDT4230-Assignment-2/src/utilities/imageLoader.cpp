@@ -1,41 +1,204 @@
 #include "imageLoader.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include "mappedFile.h"
 
-// Original source: https://raw.githubusercontent.com/lvandeve/lodepng/master/examples/example_decode.cpp
-PNGImage loadPNGFile(std::string fileName)
+// Only decoding from memory is used, as files are mapped by loadPNGFile()
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#include "stb_image.h"
+
+struct RawImageHeader {
+	char magic[4];
+	std::uint32_t width;
+	std::uint32_t height;
+};
+
+static const char rawImageMagic[4] = { 'R', 'G', 'B', 'A' };
+static const unsigned char pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+// Which decoder to use for each format. benchmarkImages() times them all on
+// our textures, so change these if it finds a faster one.
+static ImageDecoder preferredDecoders[] = {
+	DECODER_LODEPNG,   // IMAGE_PNG
+	DECODER_RAW,       // IMAGE_RAW
+	DECODER_STB_IMAGE, // IMAGE_OTHER
+};
+
+ImageFormat detectImageFormat(const unsigned char *data, size_t size)
 {
-	std::vector<unsigned char> png;
-	std::vector<unsigned char> pixels; //the raw pixels
-	unsigned int width, height;
+	if (size >= sizeof(pngSignature) && memcmp(data, pngSignature, sizeof(pngSignature)) == 0) {
+		return IMAGE_PNG;
+	}
+	if (size >= sizeof(RawImageHeader) && memcmp(data, rawImageMagic, sizeof(rawImageMagic)) == 0) {
+		return IMAGE_RAW;
+	}
+	return IMAGE_OTHER;
+}
 
-	//load and decode
-	unsigned error = lodepng::load_file(png, fileName);
-	if(!error) error = lodepng::decode(pixels, width, height, png);
+bool decoderSupports(ImageDecoder decoder, ImageFormat format)
+{
+	switch (decoder) {
+		case DECODER_LODEPNG: return format == IMAGE_PNG;
+		case DECODER_STB_IMAGE: return format != IMAGE_RAW;
+		case DECODER_RAW: return format == IMAGE_RAW;
+	}
+	return false;
+}
 
-	//if there's an error, display it
-	if(error) std::cout << "decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+const char *imageDecoderName(ImageDecoder decoder)
+{
+	switch (decoder) {
+		case DECODER_LODEPNG: return "lodepng";
+		case DECODER_STB_IMAGE: return "stb_image";
+		case DECODER_RAW: return "raw";
+	}
+	return "unknown";
+}
+
+ImageDecoder preferredDecoder(ImageFormat format)
+{
+	return preferredDecoders[format];
+}
 
-	//the pixels are now in the vector "image", 4 bytes per pixel, ordered RGBARGBA..., use it as texture, draw it, ...
+// Unfortunately, images usually have their origin at the top left.
+// OpenGL instead defines the origin to be on the _bottom_ left instead,
+// so swap whole rows to flip the image vertically.
+static void flipRows(PNGImage &image)
+{
+	size_t widthBytes = 4 * size_t(image.width);
+	unsigned char *pixels = image.pixels.data();
+	for(unsigned int row = 0; row < (image.height / 2); row++) {
+		unsigned char *top = pixels + row * widthBytes;
+		unsigned char *bottom = pixels + (image.height - 1 - row) * widthBytes;
+		std::swap_ranges(top, top + widthBytes, bottom);
+	}
+}
 
-	// Unfortunately, images usually have their origin at the top left.
-	// OpenGL instead defines the origin to be on the _bottom_ left instead, so
-	// here's the world's most inefficient way to flip the image vertically.
+// Original source: https://raw.githubusercontent.com/lvandeve/lodepng/master/examples/example_decode.cpp
+static bool decodeLodePNG(const unsigned char *data, size_t size, PNGImage &image)
+{
+	//decode straight into the image, so the pixels are never copied
+	unsigned error = lodepng::decode(image.pixels, image.width, image.height, data, size);
 
-	// You're welcome :)
+	//if there's an error, display it
+	if(error) {
+		std::cout << "decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+		return false;
+	}
 
-	unsigned int widthBytes = 4 * width;
+	//the pixels are now 4 bytes per pixel, ordered RGBARGBA..., use it as texture, draw it, ...
+	flipRows(image);
+	return true;
+}
 
-	for(unsigned int row = 0; row < (height / 2); row++) {
-		for(unsigned int col = 0; col < widthBytes; col++) {
-			std::swap(pixels[row * widthBytes + col], pixels[(height - 1 - row) * widthBytes + col]);
-		}
+static bool decodeStbImage(const unsigned char *data, size_t size, PNGImage &image)
+{
+	if (size > INT_MAX) {
+		std::cout << "stb_image error: the file is too large" << std::endl;
+		return false;
+	}
+	int width, height, channels;
+	unsigned char *pixels = stbi_load_from_memory(data, (int) size, &width, &height, &channels, 4);
+	if (pixels == nullptr) {
+		std::cout << "stb_image error: " << stbi_failure_reason() << std::endl;
+		return false;
 	}
 
-	PNGImage image;
-	image.width = width;
-	image.height = height;
-	image.pixels = pixels;
+	// stb_image allocates the pixels itself, so flip them while copying them out
+	image.width = (unsigned int) width;
+	image.height = (unsigned int) height;
+	size_t widthBytes = 4 * size_t(width);
+	image.pixels.resize(widthBytes * height);
+	for (int row = 0; row < height; row++) {
+		memcpy(&image.pixels[(height - 1 - row) * widthBytes], pixels + row * widthBytes, widthBytes);
+	}
+	stbi_image_free(pixels);
+	return true;
+}
 
+static bool decodeRaw(const unsigned char *data, size_t size, PNGImage &image)
+{
+	RawImageHeader header;
+	if (size < sizeof(header)) {
+		std::cout << "raw image error: the file is truncated" << std::endl;
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	size_t pixelBytes = 4 * size_t(header.width) * header.height;
+	if (memcmp(header.magic, rawImageMagic, sizeof(rawImageMagic)) != 0 || size - sizeof(header) != pixelBytes) {
+		std::cout << "raw image error: the header does not match the file" << std::endl;
+		return false;
+	}
+
+	// Stored bottom-up already
+	image.width = header.width;
+	image.height = header.height;
+	image.pixels.assign(data + sizeof(header), data + size);
+	return true;
+}
+
+bool decodeImage(ImageDecoder decoder, const unsigned char *data, size_t size, PNGImage &image)
+{
+	bool decoded = false;
+	switch (decoder) {
+		case DECODER_LODEPNG: decoded = decodeLodePNG(data, size, image); break;
+		case DECODER_STB_IMAGE: decoded = decodeStbImage(data, size, image); break;
+		case DECODER_RAW: decoded = decodeRaw(data, size, image); break;
+	}
+	if (!decoded) {
+		image.width = 0;
+		image.height = 0;
+		image.pixels.clear();
+	}
+	return decoded;
+}
+
+PNGImage loadPNGFile(const std::string &fileName)
+{
+	PNGImage image = { 0, 0, {} };
+	MappedFile file;
+	if (!file.open(fileName)) {
+		std::cout << "Could not read " << fileName << std::endl;
+		return image;
+	}
+	decodeImage(preferredDecoder(detectImageFormat(file.data(), file.size())), file.data(), file.size(), image);
 	return image;
+}
+
+std::vector<PNGImage> loadPNGFiles(const std::vector<std::string> &fileNames, ThreadPool &pool)
+{
+	std::vector<PNGImage> images(fileNames.size());
+	// One file per chunk, so that each is decoded on whichever thread is free
+	pool.parallelFor(fileNames.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			images[i] = loadPNGFile(fileNames[i]);
+		}
+	});
+	return images;
+}
+
+std::vector<unsigned char> encodeRawImage(const PNGImage &image)
+{
+	RawImageHeader header;
+	memcpy(header.magic, rawImageMagic, sizeof(rawImageMagic));
+	header.width = image.width;
+	header.height = image.height;
 
-}
\ No newline at end of file
+	std::vector<unsigned char> data(sizeof(header) + image.pixels.size());
+	memcpy(data.data(), &header, sizeof(header));
+	std::copy(image.pixels.begin(), image.pixels.end(), data.begin() + sizeof(header));
+	return data;
+}
+
+bool writeRawImage(const std::string &fileName, const PNGImage &image)
+{
+	std::vector<unsigned char> data = encodeRawImage(image);
+	std::ofstream file(fileName, std::ios::binary);
+	file.write((const char *) data.data(), (std::streamsize) data.size());
+	return file.good();
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "lodepng.h"
+#include <cstddef>
 #include <vector>
 #include <string>
+#include "threadPool.h"
 
 typedef struct PNGImage {
 	unsigned int width;
@@ -10,4 +12,41 @@ typedef struct PNGImage {
 	std::vector<unsigned char> pixels;
 } PNGImage;
 
-PNGImage loadPNGFile(std::string fileName);
+// Libraries images can be decoded with. Each decodes to RGBA8.
+enum ImageDecoder {
+	DECODER_LODEPNG,   // PNG only
+	DECODER_STB_IMAGE, // PNG, JPEG, TGA, BMP and a few more
+	DECODER_RAW        // Raw images as written by writeRawImage(), which only need copying
+};
+
+// Formats told apart by the first bytes of a file
+enum ImageFormat {
+	IMAGE_PNG,
+	IMAGE_RAW,
+	IMAGE_OTHER // Anything else, left to stb_image to recognise
+};
+
+ImageFormat detectImageFormat(const unsigned char *data, size_t size);
+bool decoderSupports(ImageDecoder decoder, ImageFormat format);
+const char *imageDecoderName(ImageDecoder decoder);
+
+// The decoder loadPNGFile() uses for files of the format
+ImageDecoder preferredDecoder(ImageFormat format);
+
+// Decodes an image held in memory into RGBA8 pixels, with the bottom row
+// first like OpenGL expects. Prints the error and returns false if decoding fails.
+bool decodeImage(ImageDecoder decoder, const unsigned char *data, size_t size, PNGImage &image);
+
+// Decodes a file with the preferred decoder for its format, which despite
+// the name need not be PNG. Prints the error and returns an empty image if
+// decoding fails.
+PNGImage loadPNGFile(const std::string &fileName);
+
+// The same for several files, decoded concurrently on the pool. The images
+// are returned in the order of fileNames.
+std::vector<PNGImage> loadPNGFiles(const std::vector<std::string> &fileNames, ThreadPool &pool = ThreadPool::shared());
+
+// Stores the pixels uncompressed behind a small header, in the machine's byte
+// order, so that loading them back is a single copy
+std::vector<unsigned char> encodeRawImage(const PNGImage &image);
+bool writeRawImage(const std::string &fileName, const PNGImage &image);
@@ -0,0 +1,42 @@
+#include "levelOfDetail.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+float focalLengthPixels(float verticalFieldOfView, float viewportHeight) {
+    return 0.5f * viewportHeight / std::tan(0.5f * verticalFieldOfView);
+}
+
+float pixelsPerModelUnit(const MeshBounds &bounds, const glm::mat4 &modelMatrix, glm::vec3 cameraPosition, float focalLength) {
+    // Non-uniform scales are covered by their largest axis
+    float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+                           std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(0.5f * (bounds.min + bounds.max), 1));
+    float radius = 0.5f * glm::length(bounds.max - bounds.min) * scale;
+
+    float distance = glm::length(centre - cameraPosition) - radius;
+    if (distance <= 0) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return scale * focalLength / distance;
+}
+
+int selectDetailLevel(const std::vector<MeshLevel> &levels, float pixelsPerUnit, int previousLevel) {
+    int count = (int) levels.size();
+    if (count <= 1 || !std::isfinite(pixelsPerUnit)) {
+        return 0;
+    }
+    int level = std::min(std::max(previousLevel, 0), count - 1);
+
+    if (levels[level].error * pixelsPerUnit > lodPixelError) {
+        while (level > 0 && levels[level].error * pixelsPerUnit > lodPixelError) {
+            level--;
+        }
+        return level;
+    }
+    while (level + 1 < count && levels[level + 1].error * pixelsPerUnit <= lodPixelError * lodHysteresis) {
+        level++;
+    }
+    return level;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "meshRegistry.h"
+
+// Picks the level of detail of a mesh from how large its error is on screen
+
+// The error, in pixels, that a level may show
+const float lodPixelError = 0.5f;
+
+// A coarser level is only picked once its error is below this fraction of
+// lodPixelError, so that a node near a switching distance does not alternate
+// between two levels from frame to frame
+const float lodHysteresis = 0.75f;
+
+// Pixels per unit of length at the distance of the focal plane, for a vertical
+// field of view (in radians) that spans viewportHeight pixels
+float focalLengthPixels(float verticalFieldOfView, float viewportHeight);
+
+// Pixels that one model unit covers at the part of the mesh's bounding sphere
+// closest to the camera. Infinite when the camera is inside the sphere.
+float pixelsPerModelUnit(const MeshBounds &bounds, const glm::mat4 &modelMatrix, glm::vec3 cameraPosition, float focalLength);
+
+// The coarsest level whose error stays within lodPixelError, starting from the
+// level used in the previous frame
+int selectDetailLevel(const std::vector<MeshLevel> &levels, float pixelsPerUnit, int previousLevel);
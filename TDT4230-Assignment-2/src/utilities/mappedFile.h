@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A file mapped read-only into memory, so it can be read (or handed to GL)
+// without first copying it into a buffer of our own. Unmapped on destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Returns false if the file does not exist, is empty or cannot be mapped
+    bool open(const std::string &fileName);
+    void close();
+
+    const unsigned char *data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    const unsigned char *mData = nullptr;
+    size_t mSize = 0;
+#ifdef _WIN32
+    void *mFile = nullptr;
+    void *mMapping = nullptr;
+#endif
+};
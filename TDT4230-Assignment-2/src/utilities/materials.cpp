@@ -0,0 +1,121 @@
+#include "materials.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "gpuBuffers.h"
+#include "textureArray.h"
+#include "textureStreamer.h"
+
+// Laid out like Material in simple.frag, with std430 rules
+struct MaterialData {
+    glm::vec4 color;
+    float roughness;
+    int surfaceLayer; // -1 without albedo and roughness maps
+    int normalLayer;  // -1 without a normal map
+    unsigned int loaded; // MaterialMaps
+};
+static_assert(sizeof(MaterialData) == 32, "MaterialData must match the std430 layout of Material");
+
+static std::vector<MaterialData> materials;
+static TextureArray surfaceArray;
+static TextureArray normalArray;
+static unsigned int surfaceLayers = 0;
+static unsigned int normalLayers = 0;
+static GLuint tableBuffer = 0;
+static size_t tableCapacity = 0;
+static bool tableChanged = true;
+
+static unsigned char toByte(float value) {
+    return (unsigned char) std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+}
+
+static void addDefaultMaterial() {
+    if (materials.empty()) {
+        MaterialDescription plain;
+        materials.push_back({ plain.color, plain.roughness, -1, -1, 0 });
+    }
+}
+
+MaterialID createMaterial(const MaterialDescription &description) {
+    addDefaultMaterial();
+    MaterialID id = (MaterialID) materials.size();
+    MaterialData data = { description.color, description.roughness, -1, -1, 0 };
+
+    if (!description.albedoFile.empty() || !description.roughnessFile.empty()) {
+        data.surfaceLayer = (int) surfaceLayers++;
+        const ChannelSource channels[4] = {
+            { description.albedoFile, 0, toByte(description.color.x) },
+            { description.albedoFile, 1, toByte(description.color.y) },
+            { description.albedoFile, 2, toByte(description.color.z) },
+            { description.roughnessFile, 0, toByte(description.roughness) },
+        };
+        streamTextureLayer(channels, TEXTURE_COLOR_ALPHA, &surfaceArray, data.surfaceLayer, [id]() {
+            materials[id].loaded |= MATERIAL_SURFACE_MAPS;
+            tableChanged = true;
+        });
+    }
+    if (!description.normalFile.empty()) {
+        data.normalLayer = (int) normalLayers++;
+        const ChannelSource channels[4] = {
+            { description.normalFile, 0, 128 },
+            { description.normalFile, 1, 128 },
+            { description.normalFile, 2, 255 },
+            { description.normalFile, 3, 255 },
+        };
+        streamTextureLayer(channels, TEXTURE_NORMAL_MAP, &normalArray, data.normalLayer, [id]() {
+            materials[id].loaded |= MATERIAL_NORMAL_MAPS;
+            tableChanged = true;
+        });
+    }
+
+    materials.push_back(data);
+    tableChanged = true;
+    return id;
+}
+
+void reportMaterialFootprint(MaterialID material, float pixels) {
+    if (material >= materials.size()) {
+        return;
+    }
+    if (materials[material].surfaceLayer >= 0) {
+        reportTextureFootprint(&surfaceArray, pixels);
+    }
+    if (materials[material].normalLayer >= 0) {
+        reportTextureFootprint(&normalArray, pixels);
+    }
+}
+
+unsigned int materialLoadedMaps(MaterialID material) {
+    return material < materials.size() ? materials[material].loaded : 0;
+}
+
+void bindMaterials() {
+    addDefaultMaterial();
+    if (tableChanged) {
+        if (materials.size() > tableCapacity) {
+            releaseBuffer(tableBuffer);
+            tableCapacity = 16;
+            while (tableCapacity < materials.size()) tableCapacity *= 2;
+            tableBuffer = createDynamicBuffer(tableCapacity * sizeof(MaterialData));
+        }
+        glNamedBufferSubData(tableBuffer, 0, materials.size() * sizeof(MaterialData), materials.data());
+        tableChanged = false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, tableBuffer);
+    // Arrays grow by being replaced, so their current textures are bound every pass
+    glBindTextureUnit(0, surfaceArray.texture);
+    glBindTextureUnit(1, normalArray.texture);
+}
+
+void releaseMaterials() {
+    releaseTextureArray(surfaceArray);
+    releaseTextureArray(normalArray);
+    releaseBuffer(tableBuffer);
+    tableBuffer = 0;
+    tableCapacity = 0;
+    materials.clear();
+    surfaceLayers = 0;
+    normalLayers = 0;
+    tableChanged = true;
+}
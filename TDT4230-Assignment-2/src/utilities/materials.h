@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <glm/glm.hpp>
+
+// Surface properties of meshes, kept in a storage buffer that simple.frag
+// indexes with its material_id uniform. The textures of every material are
+// packed and streamed into layers of two texture arrays, which stay bound for
+// a whole pass:
+//  - surface: albedo in RGB and roughness in alpha (BC3)
+//  - normal: tangent space x and y (BC5), the shader reconstructs z
+// Until a layer is loaded, and for materials without textures, the shader
+// uses the material's constant colour and roughness instead. Draws pick the
+// simple.frag variant that samples just the maps that are loaded.
+
+typedef unsigned int MaterialID;
+
+// What scene nodes start with: plain grey and medium rough
+const MaterialID defaultMaterial = 0;
+
+struct MaterialDescription {
+    glm::vec4 color = glm::vec4(0.6, 0.6, 0.6, 1.0);
+    float roughness = 0.5;
+
+    // PNG files, any of which may be empty. Roughness is read from the red channel.
+    std::string albedoFile;
+    std::string roughnessFile;
+    std::string normalFile;
+};
+
+// Maps whose layer can be sampled
+enum MaterialMaps {
+    MATERIAL_SURFACE_MAPS = 1,
+    MATERIAL_NORMAL_MAPS = 2
+};
+
+// Adds a material to the table and starts streaming its textures
+MaterialID createMaterial(const MaterialDescription &description);
+
+// Reports how many pixels across a node drawn with the material covers this
+// frame, which decides how much detail its textures get
+void reportMaterialFootprint(MaterialID material, float pixels);
+
+// Which of the material's maps are loaded, as MaterialMaps bits
+unsigned int materialLoadedMaps(MaterialID material);
+
+// Uploads the table if it changed, binds it to storage buffer binding 1, and
+// binds the surface and normal arrays to texture units 0 and 1
+void bindMaterials();
+
+// Deletes the table and the texture arrays. Texture streaming must be released first.
+void releaseMaterials();
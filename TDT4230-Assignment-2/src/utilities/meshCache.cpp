@@ -0,0 +1,122 @@
+#include "meshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include "cacheFile.h"
+#include "vertexLayout.hpp"
+
+static const char meshCacheMagic[8] = { 'G', 'B', 'M', 'E', 'S', 'H', 0, 0 };
+
+// Vertex formats as stored in the file, since setup functions have no stable value
+enum CachedVertexFormat : std::uint32_t {
+    CACHED_LIT_VERTICES = 1,
+    CACHED_UNLIT_VERTICES = 2
+};
+static const VertexFormatSetup litVertexFormat = &LitVertexLayout::setupAttributes;
+static const VertexFormatSetup unlitVertexFormat = &UnlitVertexLayout::setupAttributes;
+
+// Followed by vertexDataSize bytes of vertices, then indexDataSize bytes of indices
+struct MeshCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t vertexFormat;
+    std::uint32_t vertexStride;
+    std::uint32_t indexType;
+    std::uint32_t indexCount;
+    float error;
+    std::uint64_t key;
+    std::uint64_t vertexDataSize;
+    std::uint64_t indexDataSize;
+    float boundsMin[3];
+    float boundsMax[3];
+    std::uint32_t levelCount;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(MeshCacheHeader) == 88, "The mesh cache header must not contain padding");
+
+static size_t indexSize(std::uint32_t indexType) {
+    switch (indexType) {
+        case GL_UNSIGNED_BYTE:  return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT:   return 4;
+        default:                return 0;
+    }
+}
+
+bool writeMeshCache(const std::string &fileName, std::uint64_t key, const PackedMesh &mesh, float error, unsigned int levelCount) {
+    MeshCacheHeader header = {};
+    initCacheHeader(header, meshCacheMagic, meshCacheVersion, key);
+    if (mesh.vertexFormat == litVertexFormat) {
+        header.vertexFormat = CACHED_LIT_VERTICES;
+    } else if (mesh.vertexFormat == unlitVertexFormat) {
+        header.vertexFormat = CACHED_UNLIT_VERTICES;
+    } else {
+        return false;
+    }
+    header.vertexStride = (std::uint32_t) mesh.vertexStride;
+    header.indexType = mesh.indexType;
+    header.indexCount = mesh.indexCount;
+    header.error = error;
+    header.levelCount = levelCount;
+    header.vertexDataSize = mesh.vertexData.size();
+    header.indexDataSize = mesh.indexData.size();
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.bounds.min[i];
+        header.boundsMax[i] = mesh.bounds.max[i];
+    }
+
+    return writeFileReplacing(fileName, [&](std::ostream &out) {
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(mesh.vertexData.data()), (std::streamsize) mesh.vertexData.size());
+        out.write(reinterpret_cast<const char *>(mesh.indexData.data()), (std::streamsize) mesh.indexData.size());
+    });
+}
+
+bool loadMeshCache(const std::string &fileName, std::uint64_t key, GeometryBuffer &buffer, MeshBounds &bounds, float &error, unsigned int &levelCount) {
+    MappedFile file;
+    MeshCacheHeader header;
+    if (!file.open(fileName) || !readCacheHeader(file, meshCacheMagic, meshCacheVersion, key, header)) {
+        return false;
+    }
+
+    VertexFormatSetup vertexFormat;
+    GLsizei expectedStride;
+    switch (header.vertexFormat) {
+        case CACHED_LIT_VERTICES:
+            vertexFormat = litVertexFormat;
+            expectedStride = LitVertexLayout::stride;
+            break;
+        case CACHED_UNLIT_VERTICES:
+            vertexFormat = unlitVertexFormat;
+            expectedStride = UnlitVertexLayout::stride;
+            break;
+        default:
+            return false;
+    }
+
+    // An unknown index type has no size, which would let any index count match
+    // empty index data. The sizes are checked against the file size one at a
+    // time, so that damaged ones cannot wrap their sum around.
+    size_t dataSize = file.size() - sizeof(header);
+    if (header.vertexStride != (std::uint32_t) expectedStride
+        || header.vertexDataSize % expectedStride != 0
+        || indexSize(header.indexType) == 0
+        || header.indexDataSize % indexSize(header.indexType) != 0
+        || header.indexDataSize != (std::uint64_t) header.indexCount * indexSize(header.indexType)
+        || header.vertexDataSize > dataSize
+        || header.indexDataSize != dataSize - header.vertexDataSize) {
+        fprintf(stderr, "Ignoring damaged mesh cache file %s\n", fileName.c_str());
+        return false;
+    }
+
+    const unsigned char *vertexData = file.data() + sizeof(header);
+    const unsigned char *indexData = vertexData + header.vertexDataSize;
+    buffer = uploadMesh(vertexData, (size_t) header.vertexDataSize, vertexFormat, expectedStride,
+                        indexData, (size_t) header.indexDataSize, header.indexCount, header.indexType);
+    bounds.min = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    bounds.max = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    error = header.error;
+    levelCount = header.levelCount;
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "glutils.h"
+
+// Packed meshes stored on disk exactly as packMesh() produced them: the
+// interleaved vertices (tangent frames included), the narrowed indices, the
+// bounds and the error of the level of detail. Loading maps the file and
+// uploads straight from the mapping, so a cached mesh is neither generated nor
+// copied on the CPU.
+//
+// Files are written in the machine's byte order and are only meant to be read
+// back by the same build on the same machine.
+
+// Bump whenever the file layout, a vertex layout, a mesh generator, the mesh
+// optimiser or tangent generation changes, so that stale files are ignored
+const std::uint32_t meshCacheVersion = 3;
+
+// Writes the mesh under the given key, which identifies what it was built from,
+// with the error of its level of detail and the number of levels of the whole
+// chain, so that readers can tell when some are missing. Writes to a temporary
+// file first, so readers never see half a file.
+bool writeMeshCache(const std::string &fileName, std::uint64_t key, const PackedMesh &mesh, float error, unsigned int levelCount);
+
+// Uploads the mesh cached in the file. Returns false, leaving the outputs
+// untouched, if the file is missing, damaged, from another version or for another key.
+bool loadMeshCache(const std::string &fileName, std::uint64_t key, GeometryBuffer &buffer, MeshBounds &bounds, float &error, unsigned int &levelCount);
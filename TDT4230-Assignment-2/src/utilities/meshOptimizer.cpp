@@ -0,0 +1,304 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Copies vertex i of from, with whichever attributes the mesh has, to the end of to
+static void appendVertex(Mesh &to, const Mesh &from, size_t i) {
+    to.vertices.push_back(from.vertices[i]);
+    if (!from.normals.empty()) {
+        to.normals.push_back(from.normals[i]);
+    }
+    if (!from.textureCoordinates.empty()) {
+        to.textureCoordinates.push_back(from.textureCoordinates[i]);
+    }
+}
+
+static void reserveVertices(Mesh &mesh, const Mesh &like, size_t count) {
+    mesh.vertices.reserve(count);
+    if (!like.normals.empty()) mesh.normals.reserve(count);
+    if (!like.textureCoordinates.empty()) mesh.textureCoordinates.reserve(count);
+}
+
+// All attributes of a vertex, compared bit for bit
+struct VertexKey {
+    float values[8];
+
+    bool operator==(const VertexKey &other) const {
+        return std::memcmp(values, other.values, sizeof(values)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const {
+        // FNV-1a
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(key.values);
+        size_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(key.values); i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+static VertexKey vertexKey(const Mesh &mesh, size_t i) {
+    VertexKey key = {};
+    std::memcpy(&key.values[0], &mesh.vertices[i], sizeof(glm::vec3));
+    if (!mesh.normals.empty()) {
+        std::memcpy(&key.values[3], &mesh.normals[i], sizeof(glm::vec3));
+    }
+    if (!mesh.textureCoordinates.empty()) {
+        std::memcpy(&key.values[6], &mesh.textureCoordinates[i], sizeof(glm::vec2));
+    }
+    return key;
+}
+
+void weldVertices(Mesh &mesh) {
+    const size_t vertexCount = mesh.vertices.size();
+    const unsigned int emptySlot = std::numeric_limits<unsigned int>::max();
+
+    std::vector<VertexKey> keys(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        keys[i] = vertexKey(mesh, i);
+    }
+
+    // Open addressing with linear probing, at most half full. Each slot holds the
+    // first vertex seen with some key. Unlike std::unordered_map this needs
+    // no allocation per vertex.
+    size_t tableSize = 1;
+    while (tableSize < 2 * vertexCount) {
+        tableSize *= 2;
+    }
+    std::vector<unsigned int> table(tableSize, emptySlot);
+    std::vector<unsigned int> remap(vertexCount);
+
+    Mesh welded;
+    reserveVertices(welded, mesh, vertexCount);
+
+    VertexKeyHash hash;
+    for (size_t i = 0; i < vertexCount; i++) {
+        size_t slot = hash(keys[i]) & (tableSize - 1);
+        while (table[slot] != emptySlot && !(keys[table[slot]] == keys[i])) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == emptySlot) {
+            table[slot] = (unsigned int) i;
+            remap[i] = (unsigned int) welded.vertices.size();
+            appendVertex(welded, mesh, i);
+        } else {
+            remap[i] = remap[table[slot]];
+        }
+    }
+
+    for (unsigned int &index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices = std::move(welded.vertices);
+    mesh.normals = std::move(welded.normals);
+    mesh.textureCoordinates = std::move(welded.textureCoordinates);
+}
+
+// Tuning constants from Forsyth's article
+static const int forsythCacheSize = 32;
+static const float cacheDecayPower = 1.5f;
+static const float lastTriangleScore = 0.75f;
+static const float valenceBoostScale = 2.0f;
+static const float valenceBoostPower = 0.5f;
+
+// Vertices recently used score high, so their neighbours are drawn while they are cached.
+// Vertices with few triangles left score high, so no lonely triangles are left behind.
+static float vertexScore(int cachePosition, unsigned int remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The triangle just drawn. A fixed score, so it is not simply drawn again.
+            score = lastTriangleScore;
+        } else {
+            score = std::pow(1.0f - float(cachePosition - 3) / (forsythCacheSize - 3), cacheDecayPower);
+        }
+    }
+    return score + valenceBoostScale * std::pow(float(remainingTriangles), -valenceBoostPower);
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // The triangles using each vertex. The first remaining[v] entries from
+    // firstTriangle[v] on are the ones not drawn yet.
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices) {
+        remaining[index]++;
+    }
+    std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = (unsigned int) (i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        score[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+    }
+
+    auto updateTriangleScores = [&](unsigned int vertex, size_t &best) {
+        for (unsigned int i = firstTriangle[vertex]; i < firstTriangle[vertex] + remaining[vertex]; i++) {
+            unsigned int t = adjacency[i];
+            triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+            if (best == triangleCount || triangleScore[t] > triangleScore[best]) {
+                best = t;
+            }
+        }
+    };
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> nextCache;
+    cache.reserve(forsythCacheSize + 3);
+    nextCache.reserve(forsythCacheSize + 3);
+
+    size_t best = 0;
+    size_t firstCandidate = 0;
+    for (size_t t = 1; t < triangleCount; t++) {
+        if (triangleScore[t] > triangleScore[best]) {
+            best = t;
+        }
+    }
+
+    while (output.size() < 3 * triangleCount) {
+        if (best == triangleCount) {
+            // None of the cached vertices has triangles left, so continue with the
+            // next triangle in the original order
+            while (emitted[firstCandidate]) {
+                firstCandidate++;
+            }
+            best = firstCandidate;
+        }
+
+        const unsigned int *triangle = &indices[3 * best];
+        emitted[best] = true;
+        nextCache.clear();
+        for (int k = 0; k < 3; k++) {
+            unsigned int vertex = triangle[k];
+            output.push_back(vertex);
+
+            // Remove the triangle from the vertex's remaining triangles
+            unsigned int begin = firstTriangle[vertex];
+            unsigned int end = begin + remaining[vertex];
+            for (unsigned int i = begin; i < end; i++) {
+                if (adjacency[i] == best) {
+                    std::swap(adjacency[i], adjacency[end - 1]);
+                    remaining[vertex]--;
+                    break;
+                }
+            }
+
+            if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()) {
+                nextCache.push_back(vertex);
+            }
+        }
+        for (unsigned int vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        best = triangleCount;
+        for (size_t i = forsythCacheSize; i < nextCache.size(); i++) {
+            unsigned int vertex = nextCache[i];
+            cachePosition[vertex] = -1;
+            score[vertex] = vertexScore(-1, remaining[vertex]);
+        }
+        size_t cached = std::min(nextCache.size(), (size_t) forsythCacheSize);
+        for (size_t i = 0; i < cached; i++) {
+            unsigned int vertex = nextCache[i];
+            cachePosition[vertex] = (int) i;
+            score[vertex] = vertexScore((int) i, remaining[vertex]);
+        }
+
+        // Triangles of evicted vertices only need new scores, the next triangle is picked among the cached ones
+        size_t ignored = triangleCount;
+        for (size_t i = forsythCacheSize; i < nextCache.size(); i++) {
+            updateTriangleScores(nextCache[i], ignored);
+        }
+        for (size_t i = 0; i < cached; i++) {
+            updateTriangleScores(nextCache[i], best);
+        }
+
+        nextCache.resize(cached);
+        std::swap(cache, nextCache);
+    }
+
+    indices = std::move(output);
+}
+
+void optimizeVertexFetch(Mesh &mesh) {
+    const unsigned int notMapped = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(mesh.vertices.size(), notMapped);
+
+    Mesh reordered;
+    reserveVertices(reordered, mesh, mesh.vertices.size());
+
+    for (unsigned int &index : mesh.indices) {
+        if (remap[index] == notMapped) {
+            remap[index] = (unsigned int) reordered.vertices.size();
+            appendVertex(reordered, mesh, index);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices = std::move(reordered.vertices);
+    mesh.normals = std::move(reordered.normals);
+    mesh.textureCoordinates = std::move(reordered.textureCoordinates);
+}
+
+double averageCacheMissRatio(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize) {
+    if (indices.size() < 3) {
+        return 0.0;
+    }
+
+    // A FIFO cache holds a vertex until cacheSize other vertices were loaded after it,
+    // so it is enough to remember how many misses had happened when each vertex was loaded
+    const size_t neverLoaded = std::numeric_limits<size_t>::max();
+    std::vector<size_t> loadedAt(vertexCount, neverLoaded);
+    size_t misses = 0;
+    for (unsigned int index : indices) {
+        if (loadedAt[index] == neverLoaded || misses - loadedAt[index] >= cacheSize) {
+            loadedAt[index] = misses;
+            misses++;
+        }
+    }
+    return double(misses) / double(indices.size() / 3);
+}
+
+MeshOptimizationStats optimizeMesh(Mesh &mesh) {
+    MeshOptimizationStats stats;
+    stats.verticesBefore = mesh.vertices.size();
+    stats.acmrBefore = averageCacheMissRatio(mesh.indices, mesh.vertices.size());
+
+    weldVertices(mesh);
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeVertexFetch(mesh);
+
+    stats.verticesAfter = mesh.vertices.size();
+    stats.acmrAfter = averageCacheMissRatio(mesh.indices, mesh.vertices.size());
+    return stats;
+}
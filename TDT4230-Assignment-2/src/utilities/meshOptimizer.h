@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include "mesh.h"
+
+// Entries of the FIFO cache that averageCacheMissRatio() simulates.
+// Most GPUs since ~2010 behave roughly like a cache of 16 to 32 vertices.
+const unsigned int simulatedVertexCacheSize = 16;
+
+struct MeshOptimizationStats {
+    size_t verticesBefore;
+    size_t verticesAfter;
+    double acmrBefore;
+    double acmrAfter;
+};
+
+// Merges vertices whose position, normal and texture coordinates are bit-identical,
+// and rewrites the indices to refer to the merged vertices
+void weldVertices(Mesh &mesh);
+
+// Reorders the triangles so that consecutive triangles share vertices,
+// using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount);
+
+// Reorders the vertices in the order the indices first use them, so that
+// vertex fetches walk through memory sequentially
+void optimizeVertexFetch(Mesh &mesh);
+
+// Average cache miss ratio: transformed vertices per triangle, simulating a
+// FIFO post-transform cache. 3 is the worst case, 0.5 the best for a large grid.
+double averageCacheMissRatio(const std::vector<unsigned int> &indices, size_t vertexCount,
+                             unsigned int cacheSize = simulatedVertexCacheSize);
+
+// Welds, then optimises for the vertex cache and for vertex fetch
+MeshOptimizationStats optimizeMesh(Mesh &mesh);
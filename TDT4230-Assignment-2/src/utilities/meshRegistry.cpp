@@ -0,0 +1,362 @@
+#include "meshRegistry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <filesystem>
+#include <fmt/format.h>
+#include "cacheFile.h"
+#include "meshCache.h"
+#include "meshSimplifier.h"
+#include "objImporter.h"
+#include "shapes.h"
+
+enum MeshSource {
+    GENERATOR_SPHERE,
+    GENERATOR_CUBE,
+    GENERATOR_OBJ_FILE
+};
+
+// Everything a generator is called with. Unused values stay zero, so the
+// parameters of two calls to the same generator compare equal member by member.
+// Imported meshes are identified by their file and its size and modification time.
+struct MeshParameters {
+    MeshSource generator;
+    float values[8];
+    int counts[2];
+    bool flags[2];
+    std::string source;
+    std::uint64_t sourceStamp[2];
+
+    bool operator==(const MeshParameters &other) const {
+        return generator == other.generator
+            && source == other.source
+            && std::equal(std::begin(sourceStamp), std::end(sourceStamp), std::begin(other.sourceStamp))
+            && std::equal(std::begin(values), std::end(values), std::begin(other.values))
+            && std::equal(std::begin(counts), std::end(counts), std::begin(other.counts))
+            && std::equal(std::begin(flags), std::end(flags), std::begin(other.flags));
+    }
+};
+
+struct MeshParametersHash {
+    size_t operator()(const MeshParameters &parameters) const {
+        size_t hash = std::hash<int>()(parameters.generator);
+        auto combine = [&hash](size_t value) {
+            hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        };
+        // std::hash<float> hashes 0 and -0 alike, matching operator==
+        for (float value : parameters.values) combine(std::hash<float>()(value));
+        for (int count : parameters.counts) combine(std::hash<int>()(count));
+        for (bool flag : parameters.flags) combine(std::hash<bool>()(flag));
+        combine(std::hash<std::string>()(parameters.source));
+        for (std::uint64_t stamp : parameters.sourceStamp) combine(std::hash<std::uint64_t>()(stamp));
+        return hash;
+    }
+};
+
+// Names the cache file of the parameters
+static std::uint64_t cacheKey(const MeshParameters &parameters) {
+    std::uint64_t hash = fnv1aBasis;
+    auto add = [&hash](const void *data, size_t size) {
+        fnv1a(hash, data, size);
+    };
+    std::uint32_t generator = parameters.generator;
+    add(&generator, sizeof(generator));
+    for (float value : parameters.values) {
+        // 0 and -0 must give the same key, as they compare equal
+        float normalized = value == 0.0f ? 0.0f : value;
+        add(&normalized, sizeof(normalized));
+    }
+    add(parameters.counts, sizeof(parameters.counts));
+    for (bool flag : parameters.flags) {
+        unsigned char byte = flag ? 1 : 0;
+        add(&byte, 1);
+    }
+    add(parameters.source.data(), parameters.source.size());
+    add(parameters.sourceStamp, sizeof(parameters.sourceStamp));
+    return hash;
+}
+
+struct RegisteredMesh {
+    MeshParameters parameters;
+    std::vector<MeshLevel> levels;
+    MeshBounds bounds;
+    MeshOptimizationStats stats;
+    bool loadedFromCache;
+    unsigned int references;
+};
+
+static std::string cacheDirectory = "../res/cache/meshes";
+
+// Handles index meshes + 1. Released slots are reused by later meshes.
+static std::vector<RegisteredMesh> meshes;
+static std::vector<MeshHandle> freeHandles;
+static std::unordered_map<MeshParameters, MeshHandle, MeshParametersHash> handlesByParameters;
+
+static RegisteredMesh &registeredMesh(MeshHandle handle) {
+    return meshes[handle - 1];
+}
+
+// Fills in level 0 of a mesh as an unindexed triangle soup. For each later level,
+// mesh holds the level before it as optimised and error that level's error,
+// and both are replaced by a coarser level. Returns false if there is no such level.
+typedef std::function<bool(Mesh &mesh, int level, float &error)> MeshGenerator;
+
+static std::string cacheFileName(std::uint64_t key) {
+    return fmt::format("{}/{:016x}.mesh", cacheDirectory, key);
+}
+
+// Every level is cached in its own file
+static std::uint64_t levelCacheKey(std::uint64_t key, int level) {
+    return level == 0 ? key : (key ^ std::uint64_t(level)) * fnv1aPrime;
+}
+
+static void releaseLevels(RegisteredMesh &mesh) {
+    for (MeshLevel &level : mesh.levels) {
+        releaseGeometryBuffer(level.geometry);
+    }
+    mesh.levels.clear();
+}
+
+// Loads every level of the mesh from the cache. Each file records how many
+// levels there are, so a chain with files missing is loaded as none at all and
+// rebuilt, rather than left without its coarser levels.
+static bool loadCachedLevels(RegisteredMesh &entry, std::uint64_t key) {
+    unsigned int levelCount = 1;
+    for (unsigned int level = 0; level < levelCount; level++) {
+        std::uint64_t levelKey = levelCacheKey(key, (int) level);
+        MeshLevel loaded;
+        MeshBounds bounds;
+        unsigned int count = 0;
+        if (!loadMeshCache(cacheFileName(levelKey), levelKey, loaded.geometry, bounds, loaded.error, count)) {
+            releaseLevels(entry);
+            return false;
+        }
+        entry.levels.push_back(loaded);
+        if (level == 0) {
+            entry.bounds = bounds;
+            levelCount = count;
+        }
+        if (count != levelCount || count == 0 || count > (unsigned int) maxMeshLevels) {
+            releaseLevels(entry);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Builds every level and, if the cache is enabled, writes each one to it
+static bool buildLevels(RegisteredMesh &entry, std::uint64_t key, const MeshGenerator &generate) {
+    if (!cacheDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDirectory, error);
+    }
+
+    // Only written once the chain is complete, as every file records its length
+    std::vector<PackedMesh> packedLevels;
+    Mesh mesh;
+    float error = 0;
+    for (int level = 0; level < maxMeshLevels; level++) {
+        if (!generate(mesh, level, error)) {
+            if (level == 0) {
+                return false;
+            }
+            break;
+        }
+        MeshOptimizationStats stats = optimizeMesh(mesh);
+        if (level == 0) {
+            entry.stats = stats;
+        }
+
+        PackedMesh packed = packMesh(mesh);
+        MeshLevel built;
+        built.geometry = uploadMesh(packed.vertexData.data(), packed.vertexData.size(), packed.vertexFormat, packed.vertexStride,
+                                    packed.indexData.data(), packed.indexData.size(), packed.indexCount, packed.indexType);
+        built.error = error;
+        entry.levels.push_back(built);
+        if (level == 0) {
+            entry.bounds = packed.bounds;
+        }
+
+        if (!cacheDirectory.empty()) {
+            packedLevels.push_back(std::move(packed));
+        }
+    }
+
+    for (size_t level = 0; level < packedLevels.size(); level++) {
+        std::uint64_t levelKey = levelCacheKey(key, (int) level);
+        if (!writeMeshCache(cacheFileName(levelKey), levelKey, packedLevels[level], entry.levels[level].error,
+                            (unsigned int) packedLevels.size())) {
+            fprintf(stderr, "Could not write the mesh cache file %s\n", cacheFileName(levelKey).c_str());
+        }
+    }
+    return true;
+}
+
+static MeshHandle acquire(const MeshParameters &parameters, const MeshGenerator &generate) {
+    auto found = handlesByParameters.find(parameters);
+    if (found != handlesByParameters.end()) {
+        registeredMesh(found->second).references++;
+        return found->second;
+    }
+
+    RegisteredMesh entry = {};
+    entry.parameters = parameters;
+    entry.references = 1;
+
+    std::uint64_t key = cacheKey(parameters);
+    entry.loadedFromCache = !cacheDirectory.empty() && loadCachedLevels(entry, key);
+    if (!entry.loadedFromCache && !buildLevels(entry, key, generate)) {
+        releaseLevels(entry);
+        return 0;
+    }
+
+    MeshHandle handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        registeredMesh(handle) = std::move(entry);
+    } else {
+        meshes.push_back(std::move(entry));
+        handle = (MeshHandle) meshes.size();
+    }
+    handlesByParameters.emplace(parameters, handle);
+    return handle;
+}
+
+// How far a sphere of the given resolution is from a perfect one: the sagitta
+// of the longer of the arcs between neighbouring slices and layers
+static float sphereError(float radius, int slices, int layers) {
+    const float pi = 3.14159265f;
+    float halfStep = std::max(pi / slices, pi / (2 * layers));
+    return radius * (1 - std::cos(halfStep));
+}
+
+MeshHandle acquireSphere(float radius, int slices, int layers) {
+    MeshParameters parameters = {};
+    parameters.generator = GENERATOR_SPHERE;
+    parameters.values[0] = radius;
+    parameters.counts[0] = slices;
+    parameters.counts[1] = layers;
+
+    // Every level halves the resolution, down to a minimum
+    const int minimumResolution = 6;
+    return acquire(parameters, [=](Mesh &mesh, int level, float &error) {
+        int levelSlices = slices, levelLayers = layers;
+        for (int i = 0; i < level; i++) {
+            int coarserSlices = std::max(levelSlices / 2, std::min(levelSlices, minimumResolution));
+            int coarserLayers = std::max(levelLayers / 2, std::min(levelLayers, minimumResolution));
+            if (coarserSlices == levelSlices && coarserLayers == levelLayers) {
+                return false;
+            }
+            levelSlices = coarserSlices;
+            levelLayers = coarserLayers;
+        }
+        mesh = generateSphere(radius, levelSlices, levelLayers);
+        error = sphereError(radius, levelSlices, levelLayers) - sphereError(radius, slices, layers);
+        return true;
+    });
+}
+
+MeshHandle acquireCube(glm::vec3 scale, glm::vec2 textureScale, bool tilingTextures, bool inverted, glm::vec3 textureScale3d) {
+    MeshParameters parameters = {};
+    parameters.generator = GENERATOR_CUBE;
+    const float values[] = { scale.x, scale.y, scale.z, textureScale.x, textureScale.y,
+                             textureScale3d.x, textureScale3d.y, textureScale3d.z };
+    std::copy(std::begin(values), std::end(values), parameters.values);
+    parameters.flags[0] = tilingTextures;
+    parameters.flags[1] = inverted;
+
+    // Twelve triangles cannot get any simpler
+    return acquire(parameters, [=](Mesh &mesh, int level, float &) {
+        if (level > 0) {
+            return false;
+        }
+        mesh = cube(scale, textureScale, tilingTextures, inverted, textureScale3d);
+        return true;
+    });
+}
+
+MeshHandle acquireOBJ(const std::string &fileName) {
+    MeshParameters parameters = {};
+    parameters.generator = GENERATOR_OBJ_FILE;
+    parameters.source = fileName;
+    std::error_code error;
+    parameters.sourceStamp[0] = std::filesystem::file_size(fileName, error);
+    if (error) {
+        fprintf(stderr, "Could not read %s\n", fileName.c_str());
+        return 0;
+    }
+    parameters.sourceStamp[1] = (std::uint64_t) std::filesystem::last_write_time(fileName, error).time_since_epoch().count();
+
+    // Every level halves the triangles of the one before, as long as the
+    // simplifier gets reasonably close to that
+    const size_t minimumTriangles = 64;
+    return acquire(parameters, [=](Mesh &mesh, int level, float &error) {
+        if (level == 0) {
+            return importOBJ(fileName, mesh);
+        }
+        size_t previousIndexCount = mesh.indices.size();
+        if (previousIndexCount < 3 * 2 * minimumTriangles) {
+            return false;
+        }
+        error += simplifyMesh(mesh, previousIndexCount / 2);
+        return mesh.indices.size() <= previousIndexCount * 3 / 4;
+    });
+}
+
+void acquireMesh(MeshHandle handle) {
+    registeredMesh(handle).references++;
+}
+
+void releaseMesh(MeshHandle handle) {
+    RegisteredMesh &mesh = registeredMesh(handle);
+    if (mesh.references == 0 || --mesh.references > 0) {
+        return;
+    }
+    releaseLevels(mesh);
+    handlesByParameters.erase(mesh.parameters);
+    freeHandles.push_back(handle);
+}
+
+const GeometryBuffer &meshGeometry(MeshHandle handle) {
+    return registeredMesh(handle).levels[0].geometry;
+}
+
+const std::vector<MeshLevel> &meshLevels(MeshHandle handle) {
+    return registeredMesh(handle).levels;
+}
+
+const MeshBounds &meshBounds(MeshHandle handle) {
+    return registeredMesh(handle).bounds;
+}
+
+const MeshOptimizationStats &meshOptimizationStats(MeshHandle handle) {
+    return registeredMesh(handle).stats;
+}
+
+bool meshLoadedFromCache(MeshHandle handle) {
+    return registeredMesh(handle).loadedFromCache;
+}
+
+void setMeshCacheDirectory(const std::string &directory) {
+    cacheDirectory = directory;
+}
+
+size_t registeredMeshCount() {
+    return handlesByParameters.size();
+}
+
+void releaseAllMeshes() {
+    for (RegisteredMesh &mesh : meshes) {
+        releaseLevels(mesh);
+    }
+    meshes.clear();
+    freeHandles.clear();
+    handlesByParameters.clear();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "glutils.h"
+#include "meshOptimizer.h"
+
+// Generated and imported meshes, shared by everything that asks for the same
+// generator parameters or file. The first request builds, optimises and uploads the mesh,
+// later ones only look it up and take a reference, so any number of identical
+// balls or boxes share one vertex and index buffer.
+//
+// Built meshes are also written to the mesh cache (see meshCache.h), and later
+// runs upload them from there instead of generating them again.
+
+// Identifies a mesh in the registry. 0 is never a valid handle.
+typedef unsigned int MeshHandle;
+
+// Levels of detail a mesh has at most. Spheres halve their resolution and
+// imported meshes their triangle count from one level to the next.
+const int maxMeshLevels = 4;
+
+struct MeshLevel {
+    GeometryBuffer geometry;
+    // How far this level's surface may be from the full mesh's, in model units
+    float error;
+};
+
+// All of these take a reference that is given back with releaseMesh()
+MeshHandle acquireSphere(float radius, int slices, int layers);
+MeshHandle acquireCube(glm::vec3 scale = glm::vec3(1), glm::vec2 textureScale = glm::vec2(1), bool tilingTextures = false,
+                       bool inverted = false, glm::vec3 textureScale3d = glm::vec3(1));
+
+// Imports a Wavefront OBJ file, see importOBJ(). The cached copy is used until
+// the file's size or modification time changes. Returns 0 if the file cannot be imported.
+MeshHandle acquireOBJ(const std::string &fileName);
+
+// Takes another reference to a mesh that is already held
+void acquireMesh(MeshHandle handle);
+
+// Gives back a reference. The buffers are freed with the last one.
+void releaseMesh(MeshHandle handle);
+
+// The full mesh, level 0
+const GeometryBuffer &meshGeometry(MeshHandle handle);
+
+// From the full mesh to the coarsest level, at least one
+const std::vector<MeshLevel> &meshLevels(MeshHandle handle);
+const MeshBounds &meshBounds(MeshHandle handle);
+
+// Only filled in for meshes that were generated in this run
+const MeshOptimizationStats &meshOptimizationStats(MeshHandle handle);
+bool meshLoadedFromCache(MeshHandle handle);
+
+// Where cache files are read and written, relative to the working directory.
+// Defaults to ../res/cache/meshes. An empty string disables the cache.
+void setMeshCacheDirectory(const std::string &directory);
+
+// Meshes currently held by at least one reference
+size_t registeredMeshCount();
+
+// Frees every mesh, whatever its reference count. Call before the GL context goes away.
+void releaseAllMeshes();
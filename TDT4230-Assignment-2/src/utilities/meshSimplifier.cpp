@@ -0,0 +1,268 @@
+#include "meshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "meshOptimizer.h"
+
+// The symmetric 4x4 matrix of the sum of squared distances to a set of planes
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+    void addPlane(glm::dvec3 normal, double d) {
+        a2 += normal.x * normal.x; ab += normal.x * normal.y; ac += normal.x * normal.z; ad += normal.x * d;
+        b2 += normal.y * normal.y; bc += normal.y * normal.z; bd += normal.y * d;
+        c2 += normal.z * normal.z; cd += normal.z * d;
+        d2 += d * d;
+    }
+
+    void add(const Quadric &other) {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+    }
+
+    double error(glm::vec3 p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double result = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                      + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                      + c2 * z * z + 2 * cd * z
+                      + d2;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+static std::uint64_t positionBits(glm::vec3 position) {
+    std::uint32_t bits[3];
+    std::memcpy(bits, &position, sizeof(bits));
+    std::uint64_t hash = bits[0];
+    hash = hash * 0x9e3779b97f4a7c15ull ^ bits[1];
+    hash = hash * 0x9e3779b97f4a7c15ull ^ bits[2];
+    return hash * 0x9e3779b97f4a7c15ull;
+}
+
+static size_t tableSizeFor(size_t count) {
+    size_t size = 16;
+    while (size < count * 2) size *= 2;
+    return size;
+}
+
+// Marks vertices that share their position with another vertex, which happens
+// where normals or texture coordinates are discontinuous
+static void lockSeams(const Mesh &mesh, std::vector<bool> &locked) {
+    const unsigned int empty = ~0u;
+    std::vector<unsigned int> table(tableSizeFor(mesh.vertices.size()), empty);
+    size_t mask = table.size() - 1;
+    for (unsigned int v = 0; v < mesh.vertices.size(); v++) {
+        size_t slot = positionBits(mesh.vertices[v]) & mask;
+        while (table[slot] != empty && mesh.vertices[table[slot]] != mesh.vertices[v]) {
+            slot = (slot + 1) & mask;
+        }
+        if (table[slot] == empty) {
+            table[slot] = v;
+        } else {
+            locked[v] = true;
+            locked[table[slot]] = true;
+        }
+    }
+}
+
+// Marks the vertices of edges that only one triangle uses
+static void lockBorders(const std::vector<unsigned int> &indices, std::vector<bool> &locked) {
+    const std::uint64_t empty = ~0ull;
+    std::vector<std::uint64_t> table(tableSizeFor(indices.size()), empty);
+    size_t mask = table.size() - 1;
+    auto slotOf = [&](unsigned int a, unsigned int b) {
+        std::uint64_t key = (std::uint64_t(a) << 32) | b;
+        size_t slot = (key * 0x9e3779b97f4a7c15ull >> 20) & mask;
+        while (table[slot] != empty && table[slot] != key) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    };
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+            table[slotOf(a, b)] = (std::uint64_t(a) << 32) | b;
+        }
+    }
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+            if (table[slotOf(b, a)] == empty) {
+                locked[a] = true;
+                locked[b] = true;
+            }
+        }
+    }
+}
+
+// For every vertex, the triangles that use it, in compressed rows
+static void buildAdjacency(const std::vector<unsigned int> &indices, size_t vertexCount,
+                           std::vector<unsigned int> &first, std::vector<unsigned int> &triangles) {
+    first.assign(vertexCount + 1, 0);
+    for (unsigned int index : indices) {
+        first[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        first[v + 1] += first[v];
+    }
+    triangles.resize(indices.size());
+    std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        triangles[fill[indices[i]]++] = (unsigned int) (i / 3);
+    }
+}
+
+// True if moving from onto to leaves every remaining triangle around from facing the same way
+static bool keepsOrientation(const Mesh &mesh, const std::vector<unsigned int> &indices,
+                             const unsigned int *triangles, size_t triangleCount, unsigned int from, unsigned int to) {
+    for (size_t t = 0; t < triangleCount; t++) {
+        const unsigned int *corners = &indices[triangles[t] * 3];
+        if (corners[0] == to || corners[1] == to || corners[2] == to) {
+            continue; // Collapses to a line and is removed
+        }
+        glm::vec3 before[3], after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = mesh.vertices[corners[k]];
+            after[k] = corners[k] == from ? mesh.vertices[to] : before[k];
+        }
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(normalBefore, normalAfter) <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float simplifyMesh(Mesh &mesh, size_t targetIndexCount, float maxError) {
+    size_t vertexCount = mesh.vertices.size();
+    std::vector<unsigned int> &indices = mesh.indices;
+    if (indices.size() <= targetIndexCount) {
+        return 0;
+    }
+
+    std::vector<bool> locked(vertexCount, false);
+    lockSeams(mesh, locked);
+    lockBorders(indices, locked);
+
+    std::vector<Quadric> quadrics(vertexCount, Quadric());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        glm::dvec3 a(mesh.vertices[indices[i]]), b(mesh.vertices[indices[i + 1]]), c(mesh.vertices[indices[i + 2]]);
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if (length == 0) {
+            continue;
+        }
+        normal /= length;
+        double d = -glm::dot(normal, a);
+        for (int k = 0; k < 3; k++) {
+            quadrics[indices[i + k]].addPlane(normal, d);
+        }
+    }
+
+    const double maxCost = double(maxError) * double(maxError);
+    double largestCost = 0;
+    std::vector<unsigned int> first, triangles;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    std::vector<unsigned int> remap(vertexCount);
+
+    // Each pass collapses the cheapest edges that do not share triangles, then
+    // rebuilds the index buffer, until the target is reached or nothing can go
+    while (indices.size() > targetIndexCount) {
+        buildAdjacency(indices, vertexCount, first, triangles);
+
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+                // Every interior edge is seen from both of its triangles, once with a < b
+                if (a > b) {
+                    continue;
+                }
+                Quadric sum = quadrics[a];
+                sum.add(quadrics[b]);
+                if (locked[a] && locked[b]) {
+                    continue;
+                }
+                double toB = locked[a] ? 0 : sum.error(mesh.vertices[b]);
+                double toA = locked[b] ? 0 : sum.error(mesh.vertices[a]);
+                Collapse collapse = locked[b] || (!locked[a] && toB <= toA) ? Collapse{ a, b, toB } : Collapse{ b, a, toA };
+                if (collapse.cost <= maxCost) {
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) {
+            return x.cost < y.cost;
+        });
+
+        std::fill(touched.begin(), touched.end(), false);
+        for (unsigned int v = 0; v < vertexCount; v++) {
+            remap[v] = v;
+        }
+        size_t triangleCount = indices.size() / 3;
+        size_t targetTriangles = targetIndexCount / 3;
+        size_t collapsed = 0;
+        for (const Collapse &collapse : collapses) {
+            if (triangleCount <= targetTriangles) {
+                break;
+            }
+            unsigned int from = collapse.from, to = collapse.to;
+            if (touched[from] || touched[to]) {
+                continue;
+            }
+            const unsigned int *around = &triangles[first[from]];
+            size_t aroundCount = first[from + 1] - first[from];
+            if (!keepsOrientation(mesh, indices, around, aroundCount, from, to)) {
+                continue;
+            }
+
+            // The triangles around from change, so nothing else in them may collapse this pass
+            for (size_t t = 0; t < aroundCount; t++) {
+                const unsigned int *corners = &indices[around[t] * 3];
+                bool degenerate = false;
+                for (int k = 0; k < 3; k++) {
+                    touched[corners[k]] = true;
+                    degenerate |= corners[k] == to;
+                }
+                triangleCount -= degenerate ? 1 : 0;
+            }
+            remap[from] = to;
+            quadrics[to].add(quadrics[from]);
+            largestCost = std::max(largestCost, collapse.cost);
+            collapsed++;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if (a != b && b != c && c != a) {
+                indices[kept++] = a;
+                indices[kept++] = b;
+                indices[kept++] = c;
+            }
+        }
+        indices.resize(kept);
+    }
+
+    // Drops the vertices that are no longer used
+    optimizeVertexCache(indices, vertexCount);
+    optimizeVertexFetch(mesh);
+    return (float) std::sqrt(largestCost);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <limits>
+#include "mesh.h"
+
+// Removes triangles from an indexed mesh, such as one optimizeMesh() returned,
+// by collapsing edges in the order of the quadric error they add (Garland and
+// Heckbert, "Surface Simplification Using Quadric Error Metrics"). Stops once
+// at most targetIndexCount indices are left, or when the next collapse would
+// move the surface further than maxError.
+//
+// Vertices on open borders and on attribute seams (several vertices at one
+// position) are never moved, so the mesh keeps its outline and does not tear.
+// The result is optimised for the vertex cache and vertex fetch again.
+// Returns the largest error of a collapse that was made, in model units.
+float simplifyMesh(Mesh &mesh, size_t targetIndexCount, float maxError = std::numeric_limits<float>::infinity());
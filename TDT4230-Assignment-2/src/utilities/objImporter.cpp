@@ -0,0 +1,348 @@
+#include "objImporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "mappedFile.h"
+
+// Marks an attribute a corner has no index for
+static const int missingIndex = -1;
+
+// The indices of one face corner into the file's positions, texture coordinates
+// and normals. Relative (negative) OBJ indices can refer to lines before the
+// chunk, so they are stored as positions within the chunk and only become
+// indices into the whole file once the chunks before it have been counted.
+struct ObjCorner {
+    int position;
+    int textureCoordinate;
+    int normal;
+    unsigned char relative; // Bit per attribute, in the order above
+};
+
+struct ObjChunk {
+    const char *begin;
+    const char *end;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> textureCoordinates;
+    std::vector<glm::vec3> normals;
+    // Three per triangle
+    std::vector<ObjCorner> corners;
+    size_t errorLine; // 0 if the chunk parsed, otherwise the line within the chunk
+};
+
+// Hand-written number parsing, as strtod() and friends need a terminating
+// character after the mapping, and depend on the locale
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline void skipSpaces(const char *&cursor, const char *end) {
+    while (cursor < end && isSpace(*cursor)) cursor++;
+}
+
+static bool parseInteger(const char *&cursor, const char *end, long long &value) {
+    bool negative = cursor < end && *cursor == '-';
+    if (negative || (cursor < end && *cursor == '+')) cursor++;
+    if (cursor >= end || *cursor < '0' || *cursor > '9') {
+        return false;
+    }
+    value = 0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        value = value * 10 + (*cursor++ - '0');
+    }
+    if (negative) value = -value;
+    return true;
+}
+
+static bool parseFloat(const char *&cursor, const char *end, float &value) {
+    skipSpaces(cursor, end);
+    bool negative = cursor < end && *cursor == '-';
+    if (negative || (cursor < end && *cursor == '+')) cursor++;
+
+    double mantissa = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        mantissa = mantissa * 10 + (*cursor++ - '0');
+        anyDigits = true;
+    }
+    if (cursor < end && *cursor == '.') {
+        cursor++;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            mantissa = mantissa * 10 + (*cursor++ - '0');
+            exponent--;
+            anyDigits = true;
+        }
+    }
+    if (!anyDigits) {
+        return false;
+    }
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+        cursor++;
+        long long written;
+        if (!parseInteger(cursor, end, written)) {
+            return false;
+        }
+        exponent += (int) std::max(-400LL, std::min(400LL, written));
+    }
+
+    double result = exponent == 0 ? mantissa : mantissa * std::pow(10.0, exponent);
+    value = (float) (negative ? -result : result);
+    return true;
+}
+
+// One index of a corner. 1-based from the start of the file, or negative from
+// the end of what has been read so far.
+static bool parseIndex(const char *&cursor, const char *end, size_t countSoFar, int &index, bool &relative) {
+    long long written;
+    if (!parseInteger(cursor, end, written) || written == 0 || written > INT_MAX || written < -INT_MAX) {
+        return false;
+    }
+    relative = written < 0;
+    index = (int) (relative ? (long long) countSoFar + written : written - 1);
+    return true;
+}
+
+// v, v/vt, v//vn or v/vt/vn
+static bool parseCorner(const char *&cursor, const char *end, const ObjChunk &chunk, ObjCorner &corner) {
+    corner = { missingIndex, missingIndex, missingIndex, 0 };
+    bool relative;
+    if (!parseIndex(cursor, end, chunk.positions.size(), corner.position, relative)) {
+        return false;
+    }
+    corner.relative |= relative ? 1 : 0;
+    if (cursor >= end || *cursor != '/') {
+        return true;
+    }
+    cursor++;
+    if (cursor < end && *cursor != '/') {
+        if (!parseIndex(cursor, end, chunk.textureCoordinates.size(), corner.textureCoordinate, relative)) {
+            return false;
+        }
+        corner.relative |= relative ? 2 : 0;
+    }
+    if (cursor >= end || *cursor != '/') {
+        return true;
+    }
+    cursor++;
+    if (!parseIndex(cursor, end, chunk.normals.size(), corner.normal, relative)) {
+        return false;
+    }
+    corner.relative |= relative ? 4 : 0;
+    return true;
+}
+
+static bool parseLine(const char *cursor, const char *end, ObjChunk &chunk) {
+    skipSpaces(cursor, end);
+    if (cursor >= end || *cursor == '#') {
+        return true;
+    }
+    const char *keyword = cursor;
+    while (cursor < end && !isSpace(*cursor)) cursor++;
+    size_t keywordLength = cursor - keyword;
+
+    if (keywordLength == 1 && keyword[0] == 'v') {
+        glm::vec3 position;
+        if (!parseFloat(cursor, end, position.x) || !parseFloat(cursor, end, position.y) || !parseFloat(cursor, end, position.z)) {
+            return false;
+        }
+        chunk.positions.push_back(position);
+    } else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+        // A third, w coordinate is allowed and ignored
+        glm::vec2 textureCoordinate;
+        if (!parseFloat(cursor, end, textureCoordinate.x) || !parseFloat(cursor, end, textureCoordinate.y)) {
+            return false;
+        }
+        chunk.textureCoordinates.push_back(textureCoordinate);
+    } else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+        glm::vec3 normal;
+        if (!parseFloat(cursor, end, normal.x) || !parseFloat(cursor, end, normal.y) || !parseFloat(cursor, end, normal.z)) {
+            return false;
+        }
+        chunk.normals.push_back(normal);
+    } else if (keywordLength == 1 && keyword[0] == 'f') {
+        ObjCorner first = {}, previous = {}, corner;
+        int cornerCount = 0;
+        while (true) {
+            skipSpaces(cursor, end);
+            if (cursor >= end || *cursor == '#') {
+                break;
+            }
+            if (!parseCorner(cursor, end, chunk, corner)) {
+                return false;
+            }
+            // Fan triangulation, which is right for the convex polygons exporters write
+            if (cornerCount == 0) {
+                first = corner;
+            } else if (cornerCount >= 2) {
+                chunk.corners.push_back(first);
+                chunk.corners.push_back(previous);
+                chunk.corners.push_back(corner);
+            }
+            previous = corner;
+            cornerCount++;
+        }
+        if (cornerCount < 3) {
+            return false;
+        }
+    }
+    // Other statements (o, g, s, usemtl, mtllib, ...) do not affect the geometry
+    return true;
+}
+
+static void parseChunk(ObjChunk &chunk) {
+    chunk.errorLine = 0;
+    size_t line = 1;
+    const char *cursor = chunk.begin;
+    while (cursor < chunk.end) {
+        const char *lineEnd = std::find(cursor, chunk.end, '\n');
+        if (!parseLine(cursor, lineEnd, chunk)) {
+            chunk.errorLine = line;
+            return;
+        }
+        cursor = lineEnd + (lineEnd < chunk.end ? 1 : 0);
+        line++;
+    }
+}
+
+// Turns a chunk index into an index into the attribute array of the whole file
+static inline long long resolveIndex(int index, bool relative, size_t chunkStart, size_t count) {
+    if (index == missingIndex && !relative) {
+        return missingIndex;
+    }
+    long long resolved = relative ? (long long) chunkStart + index : index;
+    return resolved >= 0 && resolved < (long long) count ? resolved : -2;
+}
+
+bool parseOBJ(const char *text, size_t size, Mesh &mesh, ThreadPool &pool) {
+    // Split at line boundaries, a few chunks per thread
+    size_t chunkCount = size < parallelOBJBytes ? 1 : std::min<size_t>(size / (parallelOBJBytes / 4), 4 * pool.threadCount());
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char *end = text + size;
+    const char *begin = text;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char *chunkEnd = i + 1 == chunkCount ? end : std::max(begin, text + size * (i + 1) / chunkCount);
+        chunkEnd = std::find(chunkEnd, end, '\n');
+        chunks[i].begin = begin;
+        chunks[i].end = chunkEnd;
+        begin = chunkEnd + (chunkEnd < end ? 1 : 0);
+    }
+
+    pool.parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            parseChunk(chunks[i]);
+        }
+    });
+
+    // Where each chunk's attributes and triangles start in the whole file
+    std::vector<size_t> positionStart(chunkCount + 1, 0), textureCoordinateStart(chunkCount + 1, 0);
+    std::vector<size_t> normalStart(chunkCount + 1, 0), cornerStart(chunkCount + 1, 0);
+    for (size_t i = 0; i < chunkCount; i++) {
+        const ObjChunk &chunk = chunks[i];
+        if (chunk.errorLine != 0) {
+            size_t linesBefore = std::count(text, chunk.begin, '\n');
+            fprintf(stderr, "Malformed OBJ statement on line %zu\n", linesBefore + chunk.errorLine);
+            return false;
+        }
+        positionStart[i + 1] = positionStart[i] + chunk.positions.size();
+        textureCoordinateStart[i + 1] = textureCoordinateStart[i] + chunk.textureCoordinates.size();
+        normalStart[i + 1] = normalStart[i] + chunk.normals.size();
+        cornerStart[i + 1] = cornerStart[i] + chunk.corners.size();
+    }
+    size_t positionCount = positionStart[chunkCount];
+    size_t textureCoordinateCount = textureCoordinateStart[chunkCount];
+    size_t normalCount = normalStart[chunkCount];
+    size_t cornerCount = cornerStart[chunkCount];
+
+    // Corners may refer to attributes of any chunk, so all of them are gathered first
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> textureCoordinates;
+    std::vector<glm::vec3> normals;
+    if (chunkCount == 1) {
+        positions.swap(chunks[0].positions);
+        textureCoordinates.swap(chunks[0].textureCoordinates);
+        normals.swap(chunks[0].normals);
+    } else {
+        positions.resize(positionCount);
+        textureCoordinates.resize(textureCoordinateCount);
+        normals.resize(normalCount);
+        pool.parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), positions.begin() + positionStart[i]);
+                std::copy(chunks[i].textureCoordinates.begin(), chunks[i].textureCoordinates.end(),
+                          textureCoordinates.begin() + textureCoordinateStart[i]);
+                std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), normals.begin() + normalStart[i]);
+                // Not needed any more, which lowers the peak memory use
+                std::vector<glm::vec3>().swap(chunks[i].positions);
+                std::vector<glm::vec2>().swap(chunks[i].textureCoordinates);
+                std::vector<glm::vec3>().swap(chunks[i].normals);
+            }
+        });
+    }
+
+    mesh.vertices.resize(cornerCount);
+    mesh.normals.resize(cornerCount);
+    mesh.textureCoordinates.resize(textureCoordinateCount > 0 ? cornerCount : 0);
+    mesh.indices.resize(cornerCount);
+
+    std::atomic<bool> outOfRange(false);
+    pool.parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            const std::vector<ObjCorner> &corners = chunks[i].corners;
+            size_t out = cornerStart[i];
+            for (size_t c = 0; c < corners.size(); c += 3, out += 3) {
+                long long resolved[3][3];
+                for (int k = 0; k < 3; k++) {
+                    const ObjCorner &corner = corners[c + k];
+                    resolved[k][0] = resolveIndex(corner.position, corner.relative & 1, positionStart[i], positionCount);
+                    resolved[k][1] = resolveIndex(corner.textureCoordinate, corner.relative & 2, textureCoordinateStart[i], textureCoordinateCount);
+                    resolved[k][2] = resolveIndex(corner.normal, corner.relative & 4, normalStart[i], normalCount);
+                    if (resolved[k][0] < 0 || resolved[k][1] == -2 || resolved[k][2] == -2) {
+                        outOfRange = true;
+                        return;
+                    }
+                }
+
+                glm::vec3 a = positions[resolved[0][0]];
+                glm::vec3 b = positions[resolved[1][0]];
+                glm::vec3 d = positions[resolved[2][0]];
+                glm::vec3 faceNormal = glm::cross(b - a, d - a);
+                float length = glm::length(faceNormal);
+                faceNormal = length > 0 ? faceNormal / length : glm::vec3(0, 0, 1);
+
+                for (int k = 0; k < 3; k++) {
+                    mesh.vertices[out + k] = positions[resolved[k][0]];
+                    mesh.normals[out + k] = resolved[k][2] >= 0 ? normals[resolved[k][2]] : faceNormal;
+                    if (textureCoordinateCount > 0) {
+                        mesh.textureCoordinates[out + k] = resolved[k][1] >= 0 ? textureCoordinates[resolved[k][1]] : glm::vec2(0);
+                    }
+                    mesh.indices[out + k] = (unsigned int) (out + k);
+                }
+            }
+            // Freed as soon as possible, which lowers the peak memory use
+            std::vector<ObjCorner>().swap(chunks[i].corners);
+        }
+    });
+    if (outOfRange) {
+        fprintf(stderr, "OBJ face refers to a vertex that does not exist\n");
+        return false;
+    }
+    return true;
+}
+
+bool importOBJ(const std::string &fileName, Mesh &mesh, ThreadPool &pool) {
+    MappedFile file;
+    if (!file.open(fileName)) {
+        fprintf(stderr, "Could not read %s\n", fileName.c_str());
+        return false;
+    }
+    if (!parseOBJ(reinterpret_cast<const char *>(file.data()), file.size(), mesh, pool)) {
+        fprintf(stderr, "Could not import %s\n", fileName.c_str());
+        return false;
+    }
+    return true;
+}
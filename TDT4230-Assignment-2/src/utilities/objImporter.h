@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include "mesh.h"
+#include "threadPool.h"
+
+// Files at least this large are parsed in parallel chunks
+const size_t parallelOBJBytes = 256 * 1024;
+
+// Reads the triangles of a Wavefront OBJ file. Polygons are split into fans,
+// and faces without normals get the normal of their plane. Groups, objects
+// and materials are ignored, so everything ends up in one mesh.
+//
+// The file is mapped rather than read, and split at line boundaries into
+// chunks that are parsed on the pool. The result is an unwelded triangle soup
+// like the generators in shapes.h produce, so run optimizeMesh() on it.
+// Prints the problem and returns false if the file cannot be read or is malformed.
+bool importOBJ(const std::string &fileName, Mesh &mesh, ThreadPool &pool = ThreadPool::shared());
+
+// The same for OBJ text that is already in memory
+bool parseOBJ(const char *text, size_t size, Mesh &mesh, ThreadPool &pool = ThreadPool::shared());
@@ -0,0 +1,113 @@
+#include "programCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <ostream>
+#include <fmt/format.h>
+#include "cacheFile.h"
+
+static std::string cacheDirectory = "../res/cache/programs";
+static ProgramSetupStats setupStats;
+
+static const char programCacheMagic[8] = { 'G', 'B', 'P', 'R', 'O', 'G', 0, 0 };
+
+// Followed by binarySize bytes of program binary
+struct ProgramCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t binaryFormat;
+    std::uint64_t key;
+    std::uint64_t binarySize;
+};
+static_assert(sizeof(ProgramCacheHeader) == 32, "The program cache header must not contain padding");
+
+static std::string cacheFileName(std::uint64_t key) {
+    return fmt::format("{}/{:016x}.bin", cacheDirectory, key);
+}
+
+void setProgramCacheDirectory(const std::string &directory) {
+    cacheDirectory = directory;
+}
+
+std::uint64_t programCacheKey(const std::vector<std::string> &sources) {
+    std::uint64_t hash = fnv1aBasis;
+    const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : driverStrings) {
+        const char *value = reinterpret_cast<const char *>(glGetString(name));
+        if (value != nullptr) {
+            // The terminator keeps "ab" + "c" apart from "a" + "bc"
+            fnv1a(hash, value, std::strlen(value) + 1);
+        }
+    }
+    for (const std::string &source : sources) {
+        std::uint64_t size = source.size();
+        fnv1a(hash, &size, sizeof(size));
+        fnv1a(hash, source.data(), source.size());
+    }
+    return hash;
+}
+
+bool loadProgramBinary(GLuint program, std::uint64_t key) {
+    if (cacheDirectory.empty()) {
+        return false;
+    }
+    MappedFile file;
+    ProgramCacheHeader header;
+    if (!file.open(cacheFileName(key))
+        || !readCacheHeader(file, programCacheMagic, programCacheVersion, key, header)
+        || header.binarySize != file.size() - sizeof(header)) {
+        return false;
+    }
+
+    glProgramBinary(program, header.binaryFormat, file.data() + sizeof(header), (GLsizei) header.binarySize);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+bool saveProgramBinary(GLuint program, std::uint64_t key) {
+    if (cacheDirectory.empty()) {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (formats == 0 || linked != GL_TRUE || length <= 0) {
+        return false;
+    }
+
+    std::vector<unsigned char> binary(length);
+    GLenum binaryFormat = GL_NONE;
+    glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+    ProgramCacheHeader header = {};
+    initCacheHeader(header, programCacheMagic, programCacheVersion, key);
+    header.binaryFormat = binaryFormat;
+    header.binarySize = (std::uint64_t) length;
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    std::string fileName = cacheFileName(key);
+    bool written = writeFileReplacing(fileName, [&](std::ostream &out) {
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(binary.data()), length);
+    });
+    if (!written) {
+        fprintf(stderr, "Could not write the program cache file %s\n", fileName.c_str());
+    }
+    return written;
+}
+
+void recordProgramSetup(double milliseconds, bool loaded) {
+    setupStats.programs++;
+    setupStats.loaded += loaded ? 1 : 0;
+    setupStats.milliseconds += milliseconds;
+}
+
+const ProgramSetupStats &programSetupStats() {
+    return setupStats;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// Linked programs saved with glGetProgramBinary, so that later runs restore
+// them with glProgramBinary instead of compiling and linking their sources.
+//
+// Binaries only work with the driver that produced them, so the key covers
+// the driver's vendor, renderer and version as well as the sources. Drivers
+// may still reject a binary after an update that kept its version string, in
+// which case the program is compiled and the file replaced.
+
+// Bump whenever the file layout changes, so that stale files are ignored
+const std::uint32_t programCacheVersion = 1;
+
+// Where programs are cached, ../res/cache/programs by default. An empty
+// string disables the cache.
+void setProgramCacheDirectory(const std::string &directory);
+
+// Identifies the program linked from the sources, as preprocessed for a
+// variant, on the current driver. Needs a current GL context.
+std::uint64_t programCacheKey(const std::vector<std::string> &sources);
+
+// Restores the program cached under the key. Returns false if there is none,
+// or if the driver rejects it, leaving the program to be linked as usual.
+bool loadProgramBinary(GLuint program, std::uint64_t key);
+
+// Saves a linked program under the key. The program must have been linked
+// with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+bool saveProgramBinary(GLuint program, std::uint64_t key);
+
+// Time spent building programs, for comparing cold and warm starts
+struct ProgramSetupStats {
+    unsigned int programs = 0;
+    unsigned int loaded = 0; // Of programs, those restored from the cache
+    double milliseconds = 0;
+};
+
+void recordProgramSetup(double milliseconds, bool loaded);
+const ProgramSetupStats &programSetupStats();
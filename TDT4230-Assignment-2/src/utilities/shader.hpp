@@ -5,11 +5,19 @@
 // System headers
 #include <glad/glad.h>
 
+// Local headers
+#include "programCache.h"
+
 // Standard headers
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <fstream>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 
 namespace Gloom
@@ -34,22 +42,22 @@ namespace Gloom
         GLuint get()        { return mProgram; }
         void   destroy()    { glDeleteProgram(mProgram); }
 
-        /* Attach a shader to the current shader program */
-        void attach(std::string const &filename)
+        /* Attach a shader to the current shader program, with the given
+           #define lines inserted after its #version line */
+        void attach(std::string const &filename, std::string const &defines = "")
         {
-            // Load GLSL Shader from source
-            std::ifstream fd(filename.c_str());
-            if (fd.fail())
+            std::string src;
+            if (read(filename, defines, src))
             {
-                fprintf(stderr,
-                    "Something went wrong when attaching the Shader file at \"%s\".\n"
-                    "The file may not exist or is currently inaccessible.\n",
-                    filename.c_str());
-                return;
+                attachSource(filename, src);
             }
-            auto src = std::string(std::istreambuf_iterator<char>(fd),
-                                  (std::istreambuf_iterator<char>()));
+        }
+
 
+        /* Compile the source of a shader file and attach it to the current
+           shader program */
+        void attachSource(std::string const &filename, std::string const &src)
+        {
             // Create shader object
             const char * source = src.c_str();
             auto shader = create(filename);
@@ -74,6 +82,73 @@ namespace Gloom
         }
 
 
+        /* Read the GLSL source of a shader file, with the given #define
+           lines inserted after its #version line */
+        static bool read(std::string const &filename, std::string const &defines, std::string &src)
+        {
+            // Load GLSL Shader from source
+            std::ifstream fd(filename.c_str());
+            if (fd.fail())
+            {
+                fprintf(stderr,
+                    "Something went wrong when attaching the Shader file at \"%s\".\n"
+                    "The file may not exist or is currently inaccessible.\n",
+                    filename.c_str());
+                return false;
+            }
+            src = std::string(std::istreambuf_iterator<char>(fd),
+                             (std::istreambuf_iterator<char>()));
+            if (!defines.empty())
+            {
+                // #version must come first, and #line keeps error messages
+                // pointing at the lines of the file
+                auto version = src.find("#version");
+                auto lineEnd = version == std::string::npos ? std::string::npos : src.find('\n', version);
+                if (lineEnd == std::string::npos)
+                {
+                    src = defines + "#line 1\n" + src;
+                }
+                else
+                {
+                    auto line = std::count(src.begin(), src.begin() + lineEnd, '\n') + 2;
+                    src.insert(lineEnd + 1, defines + "#line " + std::to_string(line) + "\n");
+                }
+            }
+            return true;
+        }
+
+
+        /* Attaches and links the shader files, with the given #define lines,
+           or restores the program an earlier run linked from the same
+           sources with the same driver */
+        void build(std::vector<std::string> const &filenames, std::string const &defines = "")
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::string> sources(filenames.size());
+            for (size_t i = 0; i < filenames.size(); i++)
+            {
+                read(filenames[i], defines, sources[i]);
+            }
+
+            auto key = programCacheKey(sources);
+            bool loaded = loadProgramBinary(mProgram, key);
+            if (!loaded)
+            {
+                for (size_t i = 0; i < filenames.size(); i++)
+                {
+                    if (!sources[i].empty())
+                    {
+                        attachSource(filenames[i], sources[i]);
+                    }
+                }
+                glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+                link();
+                saveProgramBinary(mProgram, key);
+            }
+            recordProgramSetup(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), loaded);
+        }
+
+
         /* Links all attached shaders together into a shader program */
         void link()
         {
@@ -99,9 +174,7 @@ namespace Gloom
         void makeBasicShader(std::string const &vertexFilename,
                              std::string const &fragmentFilename)
         {
-            attach(vertexFilename);
-            attach(fragmentFilename);
-            link();
+            build({ vertexFilename, fragmentFilename });
         }
 
         /* Convenience function to get a uniforms ID from a string
@@ -152,6 +225,54 @@ namespace Gloom
         Shader & operator =(Shader const &) = delete;
 
     };
+
+
+    /* Variants of a program, compiled from the same files with different
+       #defines, so that each only contains the code its features need.
+       Variants are identified by a key, compiled the first time they are
+       asked for, and kept until destroy(). */
+    class ShaderPermutations
+    {
+    public:
+        // The #define lines of the variant for a key
+        typedef std::function<std::string(unsigned int key)> Defines;
+
+        ShaderPermutations(std::vector<std::string> const &filenames, Defines defines)
+            : mFilenames(filenames), mDefines(defines) {}
+
+        /* Returns the variant for the key, compiling it if it is new */
+        Shader &variant(unsigned int key)
+        {
+            auto found = mVariants.find(key);
+            if (found != mVariants.end())
+            {
+                return *found->second;
+            }
+
+            std::unique_ptr<Shader> shader(new Shader());
+            shader->build(mFilenames, mDefines(key));
+            return *mVariants.emplace(key, std::move(shader)).first->second;
+        }
+
+        /* Deletes the programs of all variants */
+        void destroy()
+        {
+            for (auto &variant : mVariants)
+            {
+                variant.second->destroy();
+            }
+            mVariants.clear();
+        }
+
+    private:
+        std::vector<std::string> mFilenames;
+        Defines mDefines;
+        std::map<unsigned int, std::unique_ptr<Shader>> mVariants;
+
+        // Disable copying and assignment
+        ShaderPermutations(ShaderPermutations const &) = delete;
+        ShaderPermutations & operator =(ShaderPermutations const &) = delete;
+    };
 }
 
 #endif
@@ -51,6 +51,10 @@ Mesh cube(glm::vec3 scale, glm::vec2 textureScale, bool tilingTextures, bool inv
     };
 
     Mesh m;
+    m.vertices.reserve(36);
+    m.normals.reserve(36);
+    m.textureCoordinates.reserve(36);
+    m.indices.reserve(36);
     for (int face = 0; face < 6; face++) {
         int offset = face * 6;
         indices[offset + 0] = faces[face][0];
@@ -93,14 +97,17 @@ Mesh cube(glm::vec3 scale, glm::vec2 textureScale, bool tilingTextures, bool inv
 Mesh generateSphere(float sphereRadius, int slices, int layers) {
     const unsigned int triangleCount = slices * layers * 2;
 
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<unsigned int> indices;
-    std::vector<glm::vec2> uvs;
+    // Built in place in the returned mesh, with every array sized up front
+    Mesh mesh;
+    std::vector<glm::vec3> &vertices = mesh.vertices;
+    std::vector<glm::vec3> &normals = mesh.normals;
+    std::vector<unsigned int> &indices = mesh.indices;
+    std::vector<glm::vec2> &uvs = mesh.textureCoordinates;
 
     vertices.reserve(3 * triangleCount);
     normals.reserve(3 * triangleCount);
     indices.reserve(3 * triangleCount);
+    uvs.reserve(3 * triangleCount);
 
     // Slices require us to define a full revolution worth of triangles.
     // Layers only requires angle varying between the bottom and the top (a layer only covers half a circle worth of angles)
@@ -198,10 +205,5 @@ Mesh generateSphere(float sphereRadius, int slices, int layers) {
         }
     }
 
-    Mesh mesh;
-    mesh.vertices = vertices;
-    mesh.normals = normals;
-    mesh.indices = indices;
-    mesh.textureCoordinates = uvs;
     return mesh;
 }
@@ -0,0 +1,32 @@
+#include "sphereImpostors.h"
+
+#include "gpuBuffers.h"
+
+static GLuint instanceBuffer = 0;
+static size_t instanceCapacity = 0;
+
+// The quads are built from gl_VertexID, but drawing still needs a VAO
+static void noAttributes(GLuint, GLuint) {}
+
+void drawSphereImpostors(const SphereInstance *instances, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (count > instanceCapacity) {
+        releaseBuffer(instanceBuffer);
+        instanceCapacity = 64;
+        while (instanceCapacity < count) instanceCapacity *= 2;
+        instanceBuffer = createDynamicBuffer(instanceCapacity * sizeof(SphereInstance));
+    }
+    glNamedBufferSubData(instanceBuffer, 0, count * sizeof(SphereInstance), instances);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+
+    bindGeometry(vertexArrayForFormat(&noAttributes), 0, 0, 0);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) count);
+}
+
+void releaseSphereImpostors() {
+    releaseBuffer(instanceBuffer);
+    instanceBuffer = 0;
+    instanceCapacity = 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Spheres drawn as one screen-space quad each. The impostor shaders
+// (res/shaders/impostor.vert and .frag) intersect the view ray with the
+// sphere and write the depth of the hit, so spheres are exact at any distance
+// and cost four vertices however many pixels they cover.
+
+// A sphere in world space, laid out like the vec4 the shaders read
+struct SphereInstance {
+    glm::vec3 center;
+    float radius;
+};
+
+// Draws all spheres with one instanced call. The impostor program must be
+// active. The instances are copied into a storage buffer at binding 0, which
+// grows as needed.
+void drawSphereImpostors(const SphereInstance *instances, size_t count);
+
+// Deletes the instance buffer
+void releaseSphereImpostors();
@@ -0,0 +1,113 @@
+#include "tangentSpace.h"
+
+#include <cmath>
+#include <vector>
+
+// Triangles handled by a single task when the work is split across threads
+static const size_t trianglesPerTask = 4096;
+
+// Some unit vector orthogonal to the unit vector n
+static glm::vec3 anyPerpendicular(glm::vec3 n) {
+    return glm::normalize(glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0)));
+}
+
+// Angle between the edges leaving corner a of triangle abc
+static float cornerAngle(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    glm::vec3 edge1 = b - a;
+    glm::vec3 edge2 = c - a;
+    float lengths = glm::length(edge1) * glm::length(edge2);
+    if (!(lengths > 0)) {
+        return 0.0f;
+    }
+    return std::acos(glm::clamp(glm::dot(edge1, edge2) / lengths, -1.0f, 1.0f));
+}
+
+void generateTangents(const Mesh &mesh, glm::vec4 *tangents, ThreadPool &pool) {
+    const std::vector<unsigned int> &indices = mesh.indices;
+    const size_t vertexCount = mesh.vertices.size();
+    const size_t triangleCount = indices.size() / 3;
+    const size_t cornerCount = 3 * triangleCount;
+
+    // Below the threshold a single chunk makes parallelFor run everything on this thread
+    bool parallel = triangleCount >= parallelTangentTriangleCount;
+    size_t triangleChunk = parallel ? trianglesPerTask : triangleCount;
+    size_t vertexChunk = parallel ? trianglesPerTask : vertexCount;
+
+    // The corners (3 * triangle + corner) using each vertex, so that every vertex
+    // can gather its own sum and no two threads write to the same vertex
+    std::vector<unsigned int> firstCorner(vertexCount + 1, 0);
+    for (size_t corner = 0; corner < cornerCount; corner++) {
+        firstCorner[indices[corner] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        firstCorner[v + 1] += firstCorner[v];
+    }
+    std::vector<unsigned int> vertexCorners(cornerCount);
+    std::vector<unsigned int> fill(firstCorner.begin(), firstCorner.end() - 1);
+    for (size_t corner = 0; corner < cornerCount; corner++) {
+        vertexCorners[fill[indices[corner]]++] = (unsigned int) corner;
+    }
+
+    // Tangent directions of every triangle, and the angle at each of its corners
+    std::vector<glm::vec3> faceTangents(triangleCount);
+    std::vector<glm::vec3> faceBitangents(triangleCount);
+    std::vector<float> cornerAngles(cornerCount);
+
+    pool.parallelFor(triangleCount, triangleChunk, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const glm::vec3 &p0 = mesh.vertices[indices[3 * t + 0]];
+            const glm::vec3 &p1 = mesh.vertices[indices[3 * t + 1]];
+            const glm::vec3 &p2 = mesh.vertices[indices[3 * t + 2]];
+            const glm::vec2 &uv0 = mesh.textureCoordinates[indices[3 * t + 0]];
+            const glm::vec2 &uv1 = mesh.textureCoordinates[indices[3 * t + 1]];
+            const glm::vec2 &uv2 = mesh.textureCoordinates[indices[3 * t + 2]];
+
+            glm::vec3 deltaPos1 = p1 - p0;
+            glm::vec3 deltaPos2 = p2 - p0;
+            glm::vec2 deltaUV1 = uv1 - uv0;
+            glm::vec2 deltaUV2 = uv2 - uv0;
+
+            // Only the directions are used, so instead of dividing by the
+            // determinant it is enough to flip by its sign. Triangles with
+            // degenerate UVs contribute nothing.
+            float determinant = deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x;
+            float sign = determinant > 0 ? 1.0f : (determinant < 0 ? -1.0f : 0.0f);
+            faceTangents[t] = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * sign;
+            faceBitangents[t] = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * sign;
+
+            cornerAngles[3 * t + 0] = cornerAngle(p0, p1, p2);
+            cornerAngles[3 * t + 1] = cornerAngle(p1, p2, p0);
+            cornerAngles[3 * t + 2] = cornerAngle(p2, p0, p1);
+        }
+    });
+
+    pool.parallelFor(vertexCount, vertexChunk, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++) {
+            glm::vec3 normal = glm::normalize(mesh.normals[v]);
+            glm::vec3 tangentSum(0);
+            glm::vec3 bitangentSum(0);
+
+            for (unsigned int i = firstCorner[v]; i < firstCorner[v + 1]; i++) {
+                unsigned int corner = vertexCorners[i];
+                unsigned int triangle = corner / 3;
+                float weight = cornerAngles[corner];
+
+                // Gram-Schmidt against the vertex normal before weighting
+                glm::vec3 tangent = faceTangents[triangle] - normal * glm::dot(normal, faceTangents[triangle]);
+                float tangentLength = glm::length(tangent);
+                if (tangentLength > 0) {
+                    tangentSum += tangent * (weight / tangentLength);
+                }
+                glm::vec3 bitangent = faceBitangents[triangle] - normal * glm::dot(normal, faceBitangents[triangle]);
+                float bitangentLength = glm::length(bitangent);
+                if (bitangentLength > 0) {
+                    bitangentSum += bitangent * (weight / bitangentLength);
+                }
+            }
+
+            glm::vec3 tangent = glm::length(tangentSum) > 1e-6f ? glm::normalize(tangentSum) : anyPerpendicular(normal);
+            float handedness = glm::dot(glm::cross(normal, tangent), bitangentSum) < 0 ? -1.0f : 1.0f;
+            tangents[v] = glm::vec4(tangent, handedness);
+        }
+    });
+}
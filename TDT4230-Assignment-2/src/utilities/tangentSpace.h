@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "threadPool.h"
+
+// Meshes with fewer triangles than this are handled on the calling thread only
+const size_t parallelTangentTriangleCount = 16384;
+
+// Computes a tangent per vertex of an indexed triangle mesh with normals and
+// texture coordinates, following the MikkTSpace conventions: every corner's
+// tangent is projected onto the plane of the vertex normal, and the corners of
+// a shared vertex are weighted by their angle. xyz is the resulting unit tangent,
+// orthogonal to the normal, and w = ±1 is the handedness, so that
+// bitangent = w * cross(normal, tangent).
+//
+// tangents must have room for mesh.vertices.size() entries.
+void generateTangents(const Mesh &mesh, glm::vec4 *tangents, ThreadPool &pool = ThreadPool::shared());
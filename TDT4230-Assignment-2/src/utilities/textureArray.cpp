@@ -0,0 +1,125 @@
+#include "textureArray.h"
+
+#include <algorithm>
+#include <cstdio>
+
+static unsigned int levelWidth(const TextureArray &array, unsigned int level) {
+    return std::max(1u, array.width >> level);
+}
+
+static unsigned int levelHeight(const TextureArray &array, unsigned int level) {
+    return std::max(1u, array.height >> level);
+}
+
+static GLuint createArrayStorage(const TextureArray &array) {
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    glTextureStorage3D(texture, (GLsizei) (array.levelCount - array.residentLevel), array.format,
+                       levelWidth(array, array.residentLevel), levelHeight(array, array.residentLevel), array.layerCount);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+// Copies the levels that both arrays hold, for the layers both have
+static void copyResidentLevels(const TextureArray &from, const TextureArray &to) {
+    unsigned int layers = std::min(from.layerCount, to.layerCount);
+    for (unsigned int level = std::max(from.residentLevel, to.residentLevel); level < from.levelCount; level++) {
+        glCopyImageSubData(from.texture, GL_TEXTURE_2D_ARRAY, level - from.residentLevel, 0, 0, 0,
+                           to.texture, GL_TEXTURE_2D_ARRAY, level - to.residentLevel, 0, 0, 0,
+                           levelWidth(from, level), levelHeight(from, level), layers);
+    }
+}
+
+unsigned int firstResidentLevel(const TextureArray &array) {
+    unsigned int level = 0;
+    while (level + 1 < array.levelCount && std::max(levelWidth(array, level), levelHeight(array, level)) > textureArrayFirstSize) {
+        level++;
+    }
+    return level;
+}
+
+int reserveTextureArrayLayer(TextureArray &array, GLenum format, const std::vector<TextureLevel> &levels, unsigned int layer) {
+    if (levels.empty()) {
+        return -1;
+    }
+    if (array.texture == 0) {
+        array.format = format;
+        array.width = levels[0].width;
+        array.height = levels[0].height;
+        array.levelCount = (unsigned int) levels.size();
+        array.layerCount = layer + 1;
+        array.residentLevel = firstResidentLevel(array);
+        array.texture = createArrayStorage(array);
+        return 0;
+    }
+
+    int firstLevel = -1;
+    for (size_t i = 0; i < levels.size(); i++) {
+        if (levels[i].width == array.width && levels[i].height == array.height) {
+            firstLevel = (int) i;
+            break;
+        }
+    }
+    if (format != array.format || firstLevel < 0 || levels.size() - firstLevel < array.levelCount) {
+        fprintf(stderr, "A %ux%u texture does not fit into a texture array of %ux%u layers in format 0x%x\n",
+                levels[0].width, levels[0].height, array.width, array.height, array.format);
+        return -1;
+    }
+
+    if (layer >= array.layerCount) {
+        // Double the layers, so adding many layers copies each only a few times.
+        // The copies are ordered after uploads already issued into the old storage.
+        TextureArray grown = array;
+        grown.layerCount = std::max(layer + 1, 2 * array.layerCount);
+        grown.texture = createArrayStorage(grown);
+        copyResidentLevels(array, grown);
+        glDeleteTextures(1, &array.texture);
+        array = grown;
+    }
+    return firstLevel;
+}
+
+void uploadTextureArrayLevels(const TextureArray &array, unsigned int layer, unsigned int begin, unsigned int end,
+                              const std::vector<TextureLevel> &levels, int firstLevel, const unsigned char *source) {
+    size_t base = levels[firstLevel + begin].offset;
+    for (unsigned int level = begin; level < end; level++) {
+        const TextureLevel &data = levels[firstLevel + level];
+        const void *pixels = source + (data.offset - base);
+        GLint storageLevel = (GLint) (level - array.residentLevel);
+        if (array.format == GL_RGBA8) {
+            glTextureSubImage3D(array.texture, storageLevel, 0, 0, layer, data.width, data.height, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        } else {
+            glCompressedTextureSubImage3D(array.texture, storageLevel, 0, 0, layer, data.width, data.height, 1,
+                                          array.format, (GLsizei) data.size, pixels);
+        }
+    }
+}
+
+size_t textureArrayBytes(const TextureArray &array, unsigned int residentLevel) {
+    size_t bytes = 0;
+    for (unsigned int level = residentLevel; level < array.levelCount; level++) {
+        bytes += textureLevelSize(array.format, levelWidth(array, level), levelHeight(array, level));
+    }
+    return bytes * array.layerCount;
+}
+
+void setTextureArrayResidentLevel(TextureArray &array, unsigned int level) {
+    if (array.texture == 0 || level == array.residentLevel || level >= array.levelCount) {
+        return;
+    }
+    TextureArray replaced = array;
+    replaced.residentLevel = level;
+    replaced.texture = createArrayStorage(replaced);
+    copyResidentLevels(array, replaced);
+    glDeleteTextures(1, &array.texture);
+    array = replaced;
+}
+
+void releaseTextureArray(TextureArray &array) {
+    if (array.texture != 0) {
+        glDeleteTextures(1, &array.texture);
+    }
+    array = TextureArray();
+}
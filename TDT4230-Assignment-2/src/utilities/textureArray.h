@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include "textureCompression.h"
+
+// A GL_TEXTURE_2D_ARRAY whose layers share one format, size and mip chain, so
+// that a single binding serves every layer. The storage is created when the
+// first layer is filled in, and grows as later layers are added.
+//
+// Only the levels from residentLevel down are kept in the storage, so an
+// array can be sampled after uploading its small levels and be promoted to
+// finer levels later, or give up its finest levels to free memory. Sampling
+// is unaffected apart from detail, as coordinates are normalised.
+struct TextureArray {
+    GLuint texture = 0;
+    GLenum format = GL_NONE;
+    // Of the full mip chain, level 0 of which is width by height
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int levelCount = 0;
+    unsigned int layerCount = 0;
+    // The finest level in the storage, which holds it as its level 0
+    unsigned int residentLevel = 0;
+};
+
+// New arrays only keep the levels that fit into this many pixels across
+const unsigned int textureArrayFirstSize = 64;
+
+// The level new arrays start out with
+unsigned int firstResidentLevel(const TextureArray &array);
+
+// Makes sure the array has the layer, creating its storage to fit the levels
+// if it has none yet. Returns which of the levels matches level 0 of the full
+// chain, as textures larger than the array skip their largest levels, or -1
+// if the texture does not fit: another format, a smaller size or another aspect.
+int reserveTextureArrayLayer(TextureArray &array, GLenum format, const std::vector<TextureLevel> &levels, unsigned int layer);
+
+// Uploads levels begin to end - 1 of the full chain of a layer, which must be
+// resident. levels are the texture's own, firstLevel of them matching level 0.
+// source points at the data of level begin, and the others follow as in the
+// texture's data. Reads from the bound pixel unpack buffer when source is an
+// offset into it.
+void uploadTextureArrayLevels(const TextureArray &array, unsigned int layer, unsigned int begin, unsigned int end,
+                              const std::vector<TextureLevel> &levels, int firstLevel, const unsigned char *source);
+
+// Bytes of storage the levels from the given one down take, for all layers
+size_t textureArrayBytes(const TextureArray &array, unsigned int residentLevel);
+
+// Replaces the storage with one whose finest level is the given one, copying
+// the levels both have. Finer levels than before are left to be uploaded.
+void setTextureArrayResidentLevel(TextureArray &array, unsigned int level);
+
+void releaseTextureArray(TextureArray &array);
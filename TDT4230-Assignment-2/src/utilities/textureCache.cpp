@@ -0,0 +1,101 @@
+#include "textureCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include "cacheFile.h"
+
+static const char textureCacheMagic[8] = { 'G', 'B', 'T', 'E', 'X', 0, 0, 0 };
+
+// Followed by levelCount CachedTextureLevels, then dataSize bytes of level data
+struct TextureCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t format;
+    std::uint64_t key;
+    std::uint32_t levelCount;
+    std::uint32_t reserved;
+    std::uint64_t dataSize;
+};
+static_assert(sizeof(TextureCacheHeader) == 40, "The texture cache header must not contain padding");
+
+struct CachedTextureLevel {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+static_assert(sizeof(CachedTextureLevel) == 24, "Cached texture levels must not contain padding");
+
+// Larger than any texture GL allows, and small enough that level sizes cannot overflow
+static const std::uint32_t maxCachedTextureSize = 1 << 16;
+
+bool writeTextureCache(const std::string &fileName, std::uint64_t key, const EncodedTexture &texture) {
+    TextureCacheHeader header = {};
+    initCacheHeader(header, textureCacheMagic, textureCacheVersion, key);
+    header.format = texture.format;
+    header.levelCount = (std::uint32_t) texture.levels.size();
+    header.dataSize = texture.data.size();
+
+    return writeFileReplacing(fileName, [&](std::ostream &out) {
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const TextureLevel &level : texture.levels) {
+            CachedTextureLevel cached = { level.width, level.height, level.offset, level.size };
+            out.write(reinterpret_cast<const char *>(&cached), sizeof(cached));
+        }
+        out.write(reinterpret_cast<const char *>(texture.data.data()), (std::streamsize) texture.data.size());
+    });
+}
+
+bool loadTextureCache(const std::string &fileName, std::uint64_t key, MappedTexture &texture) {
+    MappedFile &file = texture.file;
+    TextureCacheHeader header;
+    if (!file.open(fileName) || !readCacheHeader(file, textureCacheMagic, textureCacheVersion, key, header)) {
+        file.close();
+        return false;
+    }
+
+    // Each part is checked against the file size before they are added up, so
+    // that a damaged size cannot wrap the sum around
+    size_t levelTableSize = size_t(header.levelCount) * sizeof(CachedTextureLevel);
+    if (header.levelCount == 0 || header.levelCount > 32
+        || header.dataSize > file.size()
+        || file.size() - header.dataSize != sizeof(header) + levelTableSize) {
+        fprintf(stderr, "Ignoring damaged texture cache file %s\n", fileName.c_str());
+        file.close();
+        return false;
+    }
+
+    std::vector<TextureLevel> levels(header.levelCount);
+    const unsigned char *table = file.data() + sizeof(header);
+    for (size_t i = 0; i < levels.size(); i++) {
+        CachedTextureLevel cached;
+        std::memcpy(&cached, table + i * sizeof(cached), sizeof(cached));
+        // Levels are uploaded with the size their format and dimensions give,
+        // so that is also the size they must have in the file
+        if (cached.width == 0 || cached.width > maxCachedTextureSize
+            || cached.height == 0 || cached.height > maxCachedTextureSize
+            || cached.size != textureLevelSize(header.format, cached.width, cached.height)
+            || cached.offset > header.dataSize || cached.size > header.dataSize - cached.offset) {
+            fprintf(stderr, "Ignoring damaged texture cache file %s\n", fileName.c_str());
+            file.close();
+            return false;
+        }
+        levels[i] = { cached.width, cached.height, (size_t) cached.offset, (size_t) cached.size };
+    }
+
+    texture.format = header.format;
+    texture.levels.swap(levels);
+    texture.data = table + levelTableSize;
+    texture.size = (size_t) header.dataSize;
+
+    // Touch every page, so the faults happen here rather than on whichever thread copies the levels
+    const size_t pageSize = 4096;
+    unsigned char touched = 0;
+    for (size_t i = 0; i < file.size(); i += pageSize) {
+        touched ^= file.data()[i];
+    }
+    volatile unsigned char sink = touched;
+    (void) sink;
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "mappedFile.h"
+#include "textureCompression.h"
+
+// Encoded textures stored on disk with their whole mip chain, so that later
+// runs neither decode the PNG nor compress it again.
+//
+// Files are written in the machine's byte order and are only meant to be read
+// back by the same build on the same machine.
+
+// Bump whenever the file layout, the mip filter or an encoder changes, so
+// that stale files are ignored
+const std::uint32_t textureCacheVersion = 2;
+
+// Writes the texture under the given key, which identifies what it was
+// encoded from. Writes to a temporary file first, so readers never see half a file.
+bool writeTextureCache(const std::string &fileName, std::uint64_t key, const EncodedTexture &texture);
+
+// A cache file mapped into memory, whose levels are uploaded straight from the mapping
+struct MappedTexture {
+    MappedFile file;
+    GLenum format = GL_NONE;
+    std::vector<TextureLevel> levels;
+    // Level offsets are relative to this
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+};
+
+// Maps the texture cached in the file and reads its pages in, so the first
+// copy out of it does not wait for the disk. Returns false if the file is
+// missing, damaged, from another version or for another key.
+bool loadTextureCache(const std::string &fileName, std::uint64_t key, MappedTexture &texture);
@@ -0,0 +1,494 @@
+#include "textureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESSION_SSE2
+#endif
+
+// dots[i] is the dot product of the RGB of pixel i with axis, whose
+// components must lie in [-255, 255]
+static void projectPixels(const unsigned char *pixels, const int axis[3], int dots[16]) {
+#ifdef TEXTURE_COMPRESSION_SSE2
+    // madd sums pairs of 16-bit products, giving r*x + g*y and b*z + a*0 for every pixel
+    const __m128i weights = _mm_setr_epi16((short) axis[0], (short) axis[1], (short) axis[2], 0,
+                                           (short) axis[0], (short) axis[1], (short) axis[2], 0);
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < 16; i += 4) {
+        __m128i four = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 4 * i));
+        __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(four, zero), weights);
+        __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(four, zero), weights);
+        // Add the two halves of every pixel
+        __m128 lowHalves = _mm_castsi128_ps(low), highHalves = _mm_castsi128_ps(high);
+        __m128i redGreen = _mm_castps_si128(_mm_shuffle_ps(lowHalves, highHalves, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i blueAlpha = _mm_castps_si128(_mm_shuffle_ps(lowHalves, highHalves, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dots + i), _mm_add_epi32(redGreen, blueAlpha));
+    }
+#else
+    for (int i = 0; i < 16; i++) {
+        const unsigned char *pixel = pixels + 4 * i;
+        dots[i] = pixel[0] * axis[0] + pixel[1] * axis[1] + pixel[2] * axis[2];
+    }
+#endif
+}
+
+static std::uint16_t packColor565(const float color[3]) {
+    int r = (int) std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int) std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int) std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (std::uint16_t) (r << 11 | g << 5 | b);
+}
+
+// The colour a GPU decodes from the 5:6:5 value
+static void unpackColor565(std::uint16_t color, int rgb[3]) {
+    int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+    rgb[0] = r << 3 | r >> 2;
+    rgb[1] = g << 2 | g >> 4;
+    rgb[2] = b << 3 | b >> 2;
+}
+
+// The ends of the line through the pixels along their principal axis, which
+// spans the block's colours
+static void principalEndpoints(const unsigned char *pixels, float low[3], float high[3]) {
+    float mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) mean[c] += pixels[4 * i + c];
+    }
+    for (int c = 0; c < 3; c++) mean[c] /= 16.0f;
+
+    // Covariance, in the order rr, rg, rb, gg, gb, bb
+    float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        float r = pixels[4 * i] - mean[0], g = pixels[4 * i + 1] - mean[1], b = pixels[4 * i + 2] - mean[2];
+        covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+        covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+    }
+
+    // Power iteration, from the row of the channel that varies most
+    float axis[3];
+    if (covariance[0] >= covariance[3] && covariance[0] >= covariance[5]) {
+        axis[0] = covariance[0]; axis[1] = covariance[1]; axis[2] = covariance[2];
+    } else if (covariance[3] >= covariance[5]) {
+        axis[0] = covariance[1]; axis[1] = covariance[3]; axis[2] = covariance[4];
+    } else {
+        axis[0] = covariance[2]; axis[1] = covariance[4]; axis[2] = covariance[5];
+    }
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+        };
+        float largest = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+        if (largest == 0) {
+            break;
+        }
+        for (int c = 0; c < 3; c++) axis[c] = next[c] / largest;
+    }
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (length == 0) {
+        // A single colour
+        for (int c = 0; c < 3; c++) low[c] = high[c] = mean[c];
+        return;
+    }
+    for (int c = 0; c < 3; c++) axis[c] /= length;
+
+    float minimum = 0, maximum = 0;
+    for (int i = 0; i < 16; i++) {
+        float t = 0;
+        for (int c = 0; c < 3; c++) t += (pixels[4 * i + c] - mean[c]) * axis[c];
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+    for (int c = 0; c < 3; c++) {
+        low[c] = mean[c] + axis[c] * minimum;
+        high[c] = mean[c] + axis[c] * maximum;
+    }
+}
+
+// Picks the nearest palette entry for every pixel along the line between the
+// endpoints, and returns the squared error of the result
+static int selectColorIndices(const unsigned char *pixels, std::uint16_t color0, std::uint16_t color1, std::uint32_t &indices) {
+    int palette[4][3];
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    int axis[3] = { palette[1][0] - palette[0][0], palette[1][1] - palette[0][1], palette[1][2] - palette[0][2] };
+    int start = palette[0][0] * axis[0] + palette[0][1] * axis[1] + palette[0][2] * axis[2];
+    int length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    int dots[16];
+    projectPixels(pixels, axis, dots);
+
+    // Palette entries in their order from color0 to color1
+    static const int order[4] = { 0, 2, 3, 1 };
+    indices = 0;
+    int error = 0;
+    for (int i = 0; i < 16; i++) {
+        int t = 6 * (dots[i] - start);
+        int step = t < length ? 0 : t < 3 * length ? 1 : t < 5 * length ? 2 : 3;
+        int index = length == 0 ? 0 : order[step];
+        indices |= std::uint32_t(index) << (2 * i);
+        for (int c = 0; c < 3; c++) {
+            int difference = pixels[4 * i + c] - palette[index][c];
+            error += difference * difference;
+        }
+    }
+    return error;
+}
+
+// The endpoints that fit the pixels best in the least squares sense, given
+// which palette entry each pixel uses. Returns false if the indices do not
+// determine both endpoints.
+static bool fitEndpoints(const unsigned char *pixels, std::uint32_t indices, float color0[3], float color1[3]) {
+    // How much of color1 each palette entry contains
+    static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float aa = 0, ab = 0, bb = 0;
+    float ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        float b = weights[indices >> (2 * i) & 3], a = 1.0f - b;
+        aa += a * a; ab += a * b; bb += b * b;
+        for (int c = 0; c < 3; c++) {
+            ax[c] += a * pixels[4 * i + c];
+            bx[c] += b * pixels[4 * i + c];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-4f) {
+        return false;
+    }
+    for (int c = 0; c < 3; c++) {
+        color0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        color1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+    return true;
+}
+
+// Four-colour mode needs color0 > color1, otherwise the block has three
+// colours and transparent black
+static void writeColorBlock(std::uint16_t color0, std::uint16_t color1, std::uint32_t indices, unsigned char *block) {
+    if (color0 < color1) {
+        std::swap(color0, color1);
+        indices ^= 0x55555555; // Swaps entries 0 and 1, and 2 and 3
+    } else if (color0 == color1) {
+        indices = 0;
+    }
+    block[0] = (unsigned char) (color0 & 0xff);
+    block[1] = (unsigned char) (color0 >> 8);
+    block[2] = (unsigned char) (color1 & 0xff);
+    block[3] = (unsigned char) (color1 >> 8);
+    for (int i = 0; i < 4; i++) {
+        block[4 + i] = (unsigned char) (indices >> (8 * i));
+    }
+}
+
+void encodeBC1Block(const unsigned char *pixels, unsigned char *block) {
+    float low[3], high[3];
+    principalEndpoints(pixels, low, high);
+    std::uint16_t color0 = packColor565(high), color1 = packColor565(low);
+    std::uint32_t indices;
+    int error = selectColorIndices(pixels, color0, color1, indices);
+
+    // One refinement: fit the endpoints to the chosen entries and pick again
+    float fitted0[3], fitted1[3];
+    if (error > 0 && fitEndpoints(pixels, indices, fitted0, fitted1)) {
+        std::uint16_t refined0 = packColor565(fitted0), refined1 = packColor565(fitted1);
+        std::uint32_t refinedIndices;
+        if (selectColorIndices(pixels, refined0, refined1, refinedIndices) < error) {
+            color0 = refined0;
+            color1 = refined1;
+            indices = refinedIndices;
+        }
+    }
+    writeColorBlock(color0, color1, indices, block);
+}
+
+void encodeBC3Block(const unsigned char *pixels, unsigned char *block) {
+    encodeBC4Block(pixels, 3, block);
+    encodeBC1Block(pixels, block + 8);
+}
+
+void encodeBC4Block(const unsigned char *pixels, int channel, unsigned char *block) {
+    int low = 255, high = 0;
+    for (int i = 0; i < 16; i++) {
+        low = std::min(low, (int) pixels[4 * i + channel]);
+        high = std::max(high, (int) pixels[4 * i + channel]);
+    }
+    // red0 > red1 selects eight values evenly spaced between them
+    block[0] = (unsigned char) high;
+    block[1] = (unsigned char) low;
+
+    std::uint64_t indices = 0;
+    if (high > low) {
+        // Palette entries in their order from low to high
+        static const int order[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+        int range = high - low;
+        for (int i = 0; i < 16; i++) {
+            int step = ((pixels[4 * i + channel] - low) * 14 + range) / (2 * range);
+            indices |= std::uint64_t(order[step]) << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        block[2 + i] = (unsigned char) (indices >> (8 * i));
+    }
+}
+
+void encodeBC5Block(const unsigned char *pixels, unsigned char *block) {
+    encodeBC4Block(pixels, 0, block);
+    encodeBC4Block(pixels, 1, block + 8);
+}
+
+// Colour channels hold sRGB values, so they are averaged in linear light,
+// as 16-bit fractions, and converted back afterwards
+struct SRGBTables {
+    std::uint16_t toLinear[256];
+    unsigned char fromLinear[65536];
+
+    SRGBTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            float linear = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            toLinear[i] = (std::uint16_t) std::lround(linear * 65535.0f);
+        }
+        for (int i = 0; i < 65536; i++) {
+            float linear = i / 65535.0f;
+            float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            fromLinear[i] = (unsigned char) std::lround(c * 255.0f);
+        }
+    }
+};
+
+static const SRGBTables &srgbTables() {
+    static const SRGBTables tables;
+    return tables;
+}
+
+// Averages 2x2 pixels of two rows into each of count pixels, channels alike.
+// Rounds to nearest, like the SSE2 path.
+static void averageRows(const unsigned char *row0, const unsigned char *row1, unsigned char *target, size_t count) {
+    size_t x = 0;
+#ifdef TEXTURE_COMPRESSION_SSE2
+    const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+    for (; x + 2 <= count; x += 2) {
+        __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 8 * x));
+        __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 8 * x));
+        // Columns 0 and 1 in the low half, 2 and 3 in the high half, summed vertically
+        __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+        __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+        __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(target + 4 * x), _mm_packus_epi16(average, zero));
+    }
+#endif
+    for (; x < count; x++) {
+        for (int c = 0; c < 4; c++) {
+            target[4 * x + c] = (unsigned char) ((row0[8 * x + c] + row0[8 * x + 4 + c] + row1[8 * x + c] + row1[8 * x + 4 + c] + 2) / 4);
+        }
+    }
+}
+
+// Like averageRows(), for rows already converted to 16-bit linear values.
+// Averages in pairs, so results can be half a step high, far below what 8 bits resolve.
+static void averageLinearRows(const std::uint16_t *row0, const std::uint16_t *row1, std::uint16_t *target, size_t count) {
+    size_t x = 0;
+#ifdef TEXTURE_COMPRESSION_SSE2
+    for (; x + 2 <= count; x += 2) {
+        __m128i top0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 8 * x));
+        __m128i top1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 8 * x + 8));
+        __m128i bottom0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 8 * x));
+        __m128i bottom1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 8 * x + 8));
+        __m128i columns01 = _mm_avg_epu16(top0, bottom0), columns23 = _mm_avg_epu16(top1, bottom1);
+        __m128i average = _mm_avg_epu16(_mm_unpacklo_epi64(columns01, columns23), _mm_unpackhi_epi64(columns01, columns23));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(target + 4 * x), average);
+    }
+#endif
+    for (; x < count; x++) {
+        for (int c = 0; c < 4; c++) {
+            unsigned int left = (row0[8 * x + c] + row1[8 * x + c] + 1) / 2;
+            unsigned int right = (row0[8 * x + 4 + c] + row1[8 * x + 4 + c] + 1) / 2;
+            target[4 * x + c] = (std::uint16_t) ((left + right + 1) / 2);
+        }
+    }
+}
+
+// Box filters a level into the next, which is half as large but at least 1x1.
+// A dimension of 1 is repeated rather than halved, and an odd last row or
+// column is dropped.
+static void downsample(const unsigned char *source, unsigned int width, unsigned int height,
+                       unsigned char *target, TextureKind kind, ThreadPool &pool) {
+    unsigned int targetWidth = std::max(1u, width / 2), targetHeight = std::max(1u, height / 2);
+    const SRGBTables &tables = srgbTables();
+    pool.parallelFor(targetHeight, 16, [&](size_t begin, size_t end) {
+        // Pixel pairs, so the averaging loops need no edge cases when the width is 1
+        std::vector<unsigned char> pairs;
+        std::vector<std::uint16_t> linear;
+        if (width == 1) {
+            pairs.resize(16);
+        }
+        bool srgb = kind == TEXTURE_COLOR || kind == TEXTURE_COLOR_ALPHA;
+        if (srgb) {
+            linear.resize(4 * (2 * size_t(targetWidth) * 2 + targetWidth));
+        }
+        for (size_t y = begin; y < end; y++) {
+            const unsigned char *row0 = source + 4 * size_t(width) * std::min<size_t>(2 * y, height - 1);
+            const unsigned char *row1 = source + 4 * size_t(width) * std::min<size_t>(2 * y + 1, height - 1);
+            if (width == 1) {
+                std::memcpy(&pairs[0], row0, 4);
+                std::memcpy(&pairs[4], row0, 4);
+                std::memcpy(&pairs[8], row1, 4);
+                std::memcpy(&pairs[12], row1, 4);
+                row0 = &pairs[0];
+                row1 = &pairs[8];
+            }
+            unsigned char *targetRow = target + 4 * y * targetWidth;
+
+            if (!srgb) {
+                averageRows(row0, row1, targetRow, targetWidth);
+            } else {
+                size_t values = 4 * 2 * size_t(targetWidth);
+                std::uint16_t *linear0 = linear.data(), *linear1 = linear0 + values, *average = linear1 + values;
+                for (size_t i = 0; i < values; i += 4) {
+                    for (int c = 0; c < 3; c++) {
+                        linear0[i + c] = tables.toLinear[row0[i + c]];
+                        linear1[i + c] = tables.toLinear[row1[i + c]];
+                    }
+                    // Alpha is linear already
+                    linear0[i + 3] = (std::uint16_t) (row0[i + 3] * 257);
+                    linear1[i + 3] = (std::uint16_t) (row1[i + 3] * 257);
+                }
+                averageLinearRows(linear0, linear1, average, targetWidth);
+                for (size_t i = 0; i < 4 * size_t(targetWidth); i += 4) {
+                    for (int c = 0; c < 3; c++) {
+                        targetRow[i + c] = tables.fromLinear[average[i + c]];
+                    }
+                    targetRow[i + 3] = (unsigned char) ((average[i + 3] + 128) / 257);
+                }
+            }
+
+            if (kind == TEXTURE_NORMAL_MAP) {
+                // Averaged normals are shorter than 1
+                for (unsigned int x = 0; x < targetWidth; x++) {
+                    unsigned char *pixel = targetRow + 4 * x;
+                    float normal[3];
+                    for (int c = 0; c < 3; c++) normal[c] = pixel[c] / 127.5f - 1.0f;
+                    float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                    if (length > 0) {
+                        for (int c = 0; c < 3; c++) {
+                            pixel[c] = (unsigned char) std::lround((normal[c] / length + 1.0f) * 127.5f);
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+static size_t blockBytes(GLenum format) {
+    switch (format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return 8;
+        case GL_COMPRESSED_RED_RGTC1:         return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return 16;
+        case GL_COMPRESSED_RG_RGTC2:          return 16;
+        default:                              return 0;
+    }
+}
+
+// Compresses every 4x4 block of the level, repeating the last row and column
+// where the size is not a multiple of 4
+static void encodeLevel(const unsigned char *pixels, const TextureLevel &level, GLenum format,
+                        unsigned char *target, ThreadPool &pool) {
+    unsigned int blocksWide = (level.width + 3) / 4, blocksHigh = (level.height + 3) / 4;
+    size_t bytes = blockBytes(format);
+    pool.parallelFor(blocksHigh, 4, [&](size_t begin, size_t end) {
+        unsigned char block[64];
+        for (size_t by = begin; by < end; by++) {
+            for (unsigned int bx = 0; bx < blocksWide; bx++) {
+                for (unsigned int y = 0; y < 4; y++) {
+                    size_t row = std::min<size_t>(4 * by + y, level.height - 1);
+                    for (unsigned int x = 0; x < 4; x++) {
+                        size_t column = std::min(4 * bx + x, level.width - 1);
+                        std::memcpy(block + 4 * (4 * y + x), pixels + 4 * (row * level.width + column), 4);
+                    }
+                }
+                unsigned char *output = target + (by * blocksWide + bx) * bytes;
+                switch (format) {
+                    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:  encodeBC1Block(block, output); break;
+                    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: encodeBC3Block(block, output); break;
+                    case GL_COMPRESSED_RED_RGTC1:          encodeBC4Block(block, 0, output); break;
+                    case GL_COMPRESSED_RG_RGTC2:           encodeBC5Block(block, output); break;
+                }
+            }
+        }
+    });
+}
+
+size_t textureLevelSize(GLenum format, unsigned int width, unsigned int height) {
+    size_t bytes = blockBytes(format);
+    return bytes == 0 ? 4 * size_t(width) * height : ((width + 3) / 4) * size_t((height + 3) / 4) * bytes;
+}
+
+EncodedTexture encodeTexture(const PNGImage &image, TextureKind kind, bool s3tcSupported, ThreadPool &pool) {
+    EncodedTexture encoded;
+    switch (kind) {
+        case TEXTURE_COLOR: {
+            bool opaque = true;
+            for (size_t i = 3; i < image.pixels.size() && opaque; i += 4) {
+                opaque = image.pixels[i] == 255;
+            }
+            if (!s3tcSupported) {
+                encoded.format = GL_RGBA8;
+            } else {
+                encoded.format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            }
+        } break;
+        case TEXTURE_COLOR_ALPHA:    encoded.format = s3tcSupported ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8; break;
+        case TEXTURE_NORMAL_MAP:     encoded.format = GL_COMPRESSED_RG_RGTC2; break;
+        case TEXTURE_SINGLE_CHANNEL: encoded.format = GL_COMPRESSED_RED_RGTC1; break;
+    }
+    if (image.width == 0 || image.height == 0) {
+        return encoded;
+    }
+
+    // Lay out the levels first, so the data is allocated once
+    size_t bytes = blockBytes(encoded.format);
+    unsigned int width = image.width, height = image.height;
+    size_t offset = 0;
+    while (true) {
+        size_t size = textureLevelSize(encoded.format, width, height);
+        encoded.levels.push_back({ width, height, offset, size });
+        offset += size;
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+    encoded.data.resize(offset);
+
+    // Smaller levels alternate between two buffers, each filtered from the one before
+    std::vector<unsigned char> scratch[2];
+    const unsigned char *pixels = image.pixels.data();
+    for (size_t i = 0; i < encoded.levels.size(); i++) {
+        const TextureLevel &level = encoded.levels[i];
+        if (bytes == 0) {
+            std::memcpy(encoded.data.data() + level.offset, pixels, level.size);
+        } else {
+            encodeLevel(pixels, level, encoded.format, encoded.data.data() + level.offset, pool);
+        }
+        if (i + 1 < encoded.levels.size()) {
+            const TextureLevel &smaller = encoded.levels[i + 1];
+            std::vector<unsigned char> &target = scratch[i % 2];
+            target.resize(4 * size_t(smaller.width) * smaller.height);
+            downsample(pixels, level.width, level.height, target.data(), kind, pool);
+            pixels = target.data();
+        }
+    }
+    return encoded;
+}
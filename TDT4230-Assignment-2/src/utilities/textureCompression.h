@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include "imageLoader.hpp"
+#include "threadPool.h"
+
+// Block compression of textures into the formats GPUs sample directly:
+// BC1 (DXT1) and BC3 (DXT5) for colour, BC4 (RGTC1) for single channels and
+// BC5 (RGTC2) for the x and y of normal maps. Every format stores 4x4 pixel
+// blocks, at 4 bits per pixel for BC1 and BC4 and 8 for BC3 and BC5.
+
+// S3TC is an extension rather than core GL, so its formats may be missing from the loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// What the channels of a texture hold, which decides its format
+enum TextureKind {
+    TEXTURE_COLOR,          // BC1 when opaque, BC3 otherwise
+    TEXTURE_COLOR_ALPHA,    // BC3, alpha holds a linear value such as roughness.
+                            // Always the same format, so textures can share an array.
+    TEXTURE_NORMAL_MAP,     // BC5 of x and y, shaders reconstruct z
+    TEXTURE_SINGLE_CHANNEL  // BC4 of the red channel
+};
+
+struct TextureLevel {
+    unsigned int width;
+    unsigned int height;
+    size_t offset;
+    size_t size;
+};
+
+// A texture with its whole mip chain, ready for upload
+struct EncodedTexture {
+    // GL_RGBA8 when the levels hold plain pixels, otherwise a compressed format
+    GLenum format;
+    // Largest first, down to 1x1
+    std::vector<TextureLevel> levels;
+    std::vector<unsigned char> data;
+};
+
+// Bytes of one level in the format, which may be GL_RGBA8 or one of the above
+size_t textureLevelSize(GLenum format, unsigned int width, unsigned int height);
+
+// Each encoder takes the 16 RGBA pixels of a block, row by row
+void encodeBC1Block(const unsigned char *pixels, unsigned char *block);
+void encodeBC3Block(const unsigned char *pixels, unsigned char *block);
+// Encodes one channel (0 to 3) of the pixels
+void encodeBC4Block(const unsigned char *pixels, int channel, unsigned char *block);
+void encodeBC5Block(const unsigned char *pixels, unsigned char *block);
+
+// Builds the box-filtered mip chain of the image and compresses every level in
+// the format that suits kind. Colour is filtered in linear light, as the
+// pixels are sRGB, and normal map levels are renormalised after filtering.
+// Without S3TC, colour textures keep plain RGBA8 levels. Rows are filtered and
+// block rows encoded in parallel on the pool.
+EncodedTexture encodeTexture(const PNGImage &image, TextureKind kind, bool s3tcSupported, ThreadPool &pool = ThreadPool::shared());
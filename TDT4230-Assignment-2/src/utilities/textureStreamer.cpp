@@ -0,0 +1,772 @@
+#include "textureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include "cacheFile.h"
+#include "gpuBuffers.h"
+#include "imageLoader.hpp"
+#include "textureCache.h"
+
+// Where a texture goes once it is resident: *texture, or a layer of array
+struct TextureTarget {
+    GLuint *texture;
+    TextureArray *array;
+    unsigned int layer;
+    std::function<void()> resident;
+};
+
+struct TextureRequest {
+    ChannelSource channels[4];
+    TextureKind kind;
+    bool s3tcSupported;
+    TextureTarget target;
+};
+
+// Either encoded on this run, or mapped from the texture cache
+struct DecodedTexture {
+    TextureTarget target;
+    EncodedTexture encoded;
+    std::unique_ptr<MappedTexture> cached;
+
+    GLenum format() const { return cached ? cached->format : encoded.format; }
+    const std::vector<TextureLevel> &levels() const { return cached ? cached->levels : encoded.levels; }
+    const unsigned char *data() const { return cached ? cached->data : encoded.data.data(); }
+    size_t size() const { return cached ? cached->size : encoded.data.size(); }
+};
+
+// An upload issued from the ring
+struct InFlightUpload {
+    TextureTarget target;
+    GLuint texture; // 0 for array layers
+    size_t offset;
+    GLsync fence;
+    // False for finer levels of arrays that were loaded already
+    bool pending;
+};
+
+// A texture array whose resolution follows how large it appears on screen
+struct ArrayResidency {
+    TextureArray *array;
+    // What each layer was loaded from, kept to upload finer levels later
+    std::vector<std::unique_ptr<DecodedTexture>> layers;
+    std::vector<int> firstLevels;
+    // Pixels across, as last reported
+    float footprint;
+    bool reported;
+    unsigned int unusedFrames;
+};
+
+struct Placeholder {
+    unsigned int color;
+    GLuint texture;
+};
+
+// Uploads from a pixel buffer must start at a multiple of the texel size,
+// this also keeps the copies into the mapping aligned
+static const size_t stagingAlignment = 256;
+static const size_t noRoom = ~size_t(0);
+// Reserved with the ring, so that issuing uploads never grows the list
+static const size_t maxInFlightUploads = 64;
+
+// Shared with the loader thread
+static std::mutex loaderMutex;
+static std::string cacheDirectory = "../res/cache/textures";
+static std::condition_variable requestsArrived;
+static std::condition_variable decodedArrived;
+static std::vector<TextureRequest> requests;
+static std::vector<DecodedTexture> decoded;
+static bool loaderStopping = false;
+static std::thread loaderThread;
+
+// Only used on the GL thread
+static std::vector<DecodedTexture> staging;  // Decoded, waiting for room in the ring
+static std::vector<InFlightUpload> inFlight; // Oldest first
+static std::vector<Placeholder> placeholders;
+static GLuint ringBuffer = 0;
+static unsigned char *ringMapping = nullptr;
+static size_t ringHead = 0;
+static size_t pendingTextures = 0;
+static std::vector<ArrayResidency> residencies;
+static size_t standaloneTextureBytes = 0;
+static size_t textureBudget = defaultTextureMemoryBudget;
+// Looked up on the GL thread, as the loader thread has no context
+static bool s3tcChecked = false;
+static bool s3tcSupported = false;
+
+static bool hasExtension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension != nullptr && std::strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Names the cache file of a texture after the contents of its PNG files and
+// how it is packed and encoded, so an edited texture is encoded again wherever
+// it lives. It takes eight bytes at a time, as hashing the files is all a
+// warm start does with them.
+static std::uint64_t cacheKey(const TextureRequest &request) {
+    std::uint64_t hash = fnv1aBasis;
+    auto add = [&hash](std::uint64_t value) {
+        fnv1aWord(hash, value);
+    };
+
+    for (int c = 0; c < 4; c++) {
+        const ChannelSource &source = request.channels[c];
+        // A file that several channels come from is hashed once
+        int sameAs = c;
+        for (int other = 0; other < c; other++) {
+            if (request.channels[other].fileName == source.fileName) {
+                sameAs = other;
+                break;
+            }
+        }
+        add(sameAs);
+        add(source.channel);
+        add(source.constant);
+
+        MappedFile file;
+        if (sameAs == c && !source.fileName.empty() && file.open(source.fileName)) {
+            const unsigned char *bytes = file.data();
+            size_t size = file.size(), i = 0;
+            for (; i + 8 <= size; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, bytes + i, sizeof(word));
+                add(word);
+            }
+            for (; i < size; i++) {
+                add(bytes[i]);
+            }
+            add(size);
+        }
+    }
+    add(request.kind);
+    add(request.s3tcSupported ? 1 : 0);
+    return hash;
+}
+
+// The image the channels of the request make up. That is a decoded file itself
+// when the request takes all four channels of one file in order. Returns
+// nullptr when none of its files could be decoded.
+static const PNGImage *packChannels(const TextureRequest &request, const std::vector<std::string> &files,
+                                    const std::vector<PNGImage> &images, PNGImage &packed) {
+    const PNGImage *sources[4] = {};
+    const PNGImage *first = nullptr;
+    for (int c = 0; c < 4; c++) {
+        const std::string &fileName = request.channels[c].fileName;
+        if (fileName.empty()) {
+            continue;
+        }
+        const PNGImage &image = images[std::find(files.begin(), files.end(), fileName) - files.begin()];
+        if (image.pixels.empty()) {
+            continue;
+        }
+        if (first == nullptr) {
+            first = &image;
+        }
+        if (image.width == first->width && image.height == first->height) {
+            sources[c] = &image;
+        } else {
+            fprintf(stderr, "%s is %ux%u, unlike the %ux%u of the texture it is packed into\n",
+                    fileName.c_str(), image.width, image.height, first->width, first->height);
+        }
+    }
+    if (first == nullptr) {
+        return nullptr;
+    }
+
+    bool whole = true;
+    for (int c = 0; c < 4; c++) {
+        whole = whole && sources[c] == first && request.channels[c].channel == c;
+    }
+    if (whole) {
+        return first;
+    }
+
+    packed.width = first->width;
+    packed.height = first->height;
+    packed.pixels.resize(first->pixels.size());
+    for (int c = 0; c < 4; c++) {
+        const ChannelSource &channel = request.channels[c];
+        for (size_t i = 0; i < packed.pixels.size(); i += 4) {
+            packed.pixels[i + c] = sources[c] != nullptr ? sources[c]->pixels[i + channel.channel] : channel.constant;
+        }
+    }
+    return &packed;
+}
+
+// Maps the cached textures of a batch, and decodes, packs, encodes and caches the rest
+static void loadBatch(const std::vector<TextureRequest> &batch, const std::string &directory, std::vector<DecodedTexture> &textures) {
+    std::vector<size_t> misses;
+    std::vector<std::string> missedFiles;
+    std::vector<std::string> cacheFiles(batch.size());
+    std::vector<std::uint64_t> keys(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+        textures[i].target = batch[i].target;
+        if (!directory.empty()) {
+            keys[i] = cacheKey(batch[i]);
+            cacheFiles[i] = fmt::format("{}/{:016x}.tex", directory, keys[i]);
+            std::unique_ptr<MappedTexture> cached = std::make_unique<MappedTexture>();
+            if (loadTextureCache(cacheFiles[i], keys[i], *cached)) {
+                textures[i].cached = std::move(cached);
+                continue;
+            }
+        }
+        misses.push_back(i);
+        for (const ChannelSource &channel : batch[i].channels) {
+            if (!channel.fileName.empty() && std::find(missedFiles.begin(), missedFiles.end(), channel.fileName) == missedFiles.end()) {
+                missedFiles.push_back(channel.fileName);
+            }
+        }
+    }
+    if (misses.empty()) {
+        return;
+    }
+
+    if (!directory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+    std::vector<PNGImage> images = loadPNGFiles(missedFiles);
+    PNGImage packed;
+    for (size_t i : misses) {
+        const PNGImage *image = packChannels(batch[i], missedFiles, images, packed);
+        if (image == nullptr) {
+            continue; // Left without levels, so it keeps its placeholder
+        }
+        textures[i].encoded = encodeTexture(*image, batch[i].kind, batch[i].s3tcSupported);
+        if (!directory.empty() && !writeTextureCache(cacheFiles[i], keys[i], textures[i].encoded)) {
+            fprintf(stderr, "Could not write the texture cache file %s\n", cacheFiles[i].c_str());
+        }
+    }
+}
+
+// Loads whatever was requested since the last batch, several files at once
+static void loaderLoop() {
+    std::vector<TextureRequest> batch;
+    std::vector<DecodedTexture> textures;
+    std::unique_lock<std::mutex> lock(loaderMutex);
+    while (true) {
+        requestsArrived.wait(lock, [] { return loaderStopping || !requests.empty(); });
+        if (loaderStopping) {
+            return;
+        }
+        batch.swap(requests);
+        std::string directory = cacheDirectory;
+        lock.unlock();
+
+        textures.resize(batch.size());
+        loadBatch(batch, directory, textures);
+
+        lock.lock();
+        for (DecodedTexture &texture : textures) {
+            decoded.push_back(std::move(texture));
+        }
+        textures.clear();
+        batch.clear();
+        decodedArrived.notify_all();
+    }
+}
+
+static GLuint placeholderTexture(glm::vec4 color) {
+    float channels[4] = { color.x, color.y, color.z, color.w };
+    unsigned char texel[4];
+    for (int i = 0; i < 4; i++) {
+        texel[i] = (unsigned char) std::lround(std::min(std::max(channels[i], 0.0f), 1.0f) * 255.0f);
+    }
+    unsigned int key;
+    std::memcpy(&key, texel, sizeof(key));
+    for (const Placeholder &placeholder : placeholders) {
+        if (placeholder.color == key) {
+            return placeholder.texture;
+        }
+    }
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RGBA8, 1, 1);
+    glTextureSubImage2D(texture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    placeholders.push_back({ key, texture });
+    return texture;
+}
+
+// Storage for the texture's levels, trilinearly filtered
+static GLuint createTexture(const DecodedTexture &decoded) {
+    const std::vector<TextureLevel> &levels = decoded.levels();
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, (GLsizei) levels.size(), decoded.format(), levels[0].width, levels[0].height);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+// The part of the texture's data that is uploaded: all of it, or for array
+// layers the levels the array holds
+static size_t uploadedOffset(const DecodedTexture &decoded, int firstLevel) {
+    const TextureArray *array = decoded.target.array;
+    return array != nullptr ? decoded.levels()[firstLevel + array->residentLevel].offset : 0;
+}
+
+// Uploads every level into the texture, or the resident levels into the layer
+// of the target's array. source points at uploadedOffset() of the data, in the
+// bound pixel unpack buffer when it is an offset into it.
+static void uploadLevels(GLuint texture, int firstLevel, const DecodedTexture &decoded, const unsigned char *source) {
+    if (decoded.target.array != nullptr) {
+        const TextureArray &array = *decoded.target.array;
+        uploadTextureArrayLevels(array, decoded.target.layer, array.residentLevel, array.levelCount,
+                                 decoded.levels(), firstLevel, source);
+        return;
+    }
+    const std::vector<TextureLevel> &levels = decoded.levels();
+    GLenum format = decoded.format();
+    for (size_t i = 0; i < levels.size(); i++) {
+        const TextureLevel &level = levels[i];
+        const void *pixels = source + level.offset;
+        if (format == GL_RGBA8) {
+            glTextureSubImage2D(texture, (GLint) i, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        } else {
+            glCompressedTextureSubImage2D(texture, (GLint) i, 0, 0, level.width, level.height, format, (GLsizei) level.size, pixels);
+        }
+    }
+}
+
+static void makeResident(TextureTarget &target, GLuint texture) {
+    if (target.array != nullptr) {
+        if (target.resident) {
+            target.resident();
+        }
+    } else {
+        *target.texture = texture;
+    }
+}
+
+// The offset of size free bytes in the ring, or noRoom until older uploads finish.
+// The ring is full when the head would reach the oldest upload still in flight,
+// or when maxInFlightUploads are.
+static size_t allocateStaging(size_t size) {
+    if (size > textureStagingBytes || inFlight.size() >= maxInFlightUploads) {
+        return noRoom;
+    }
+    if (inFlight.empty()) {
+        return 0;
+    }
+    size_t tail = inFlight.front().offset;
+    if (ringHead > tail) {
+        if (ringHead + size <= textureStagingBytes) {
+            return ringHead;
+        }
+        return size < tail ? 0 : noRoom;
+    }
+    return ringHead + size < tail ? ringHead : noRoom;
+}
+
+static void retireUploads() {
+    size_t retired = 0;
+    while (retired < inFlight.size()) {
+        InFlightUpload &upload = inFlight[retired];
+        if (glClientWaitSync(upload.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        glDeleteSync(upload.fence);
+        if (upload.pending) {
+            makeResident(upload.target, upload.texture);
+            pendingTextures--;
+        }
+        retired++;
+    }
+    inFlight.erase(inFlight.begin(), inFlight.begin() + retired);
+}
+
+static void createRing() {
+    if (ringBuffer == 0) {
+        void *mapping;
+        ringBuffer = createPersistentBuffer(textureStagingBytes, &mapping);
+        ringMapping = static_cast<unsigned char *>(mapping);
+        inFlight.reserve(maxInFlightUploads);
+    }
+}
+
+static ArrayResidency &residencyOf(TextureArray *array) {
+    for (ArrayResidency &residency : residencies) {
+        if (residency.array == array) {
+            return residency;
+        }
+    }
+    residencies.push_back({ array, {}, {}, 0.0f, false, 0 });
+    return residencies.back();
+}
+
+// Keeps what an array layer was loaded from, once its upload is issued
+static void retainLayer(DecodedTexture &texture, int firstLevel) {
+    ArrayResidency &residency = residencyOf(texture.target.array);
+    unsigned int layer = texture.target.layer;
+    if (layer >= residency.layers.size()) {
+        residency.layers.resize(layer + 1);
+        residency.firstLevels.resize(layer + 1, 0);
+    }
+    residency.layers[layer] = std::make_unique<DecodedTexture>(std::move(texture));
+    residency.firstLevels[layer] = firstLevel;
+}
+
+static void stageDecoded() {
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        for (DecodedTexture &texture : decoded) {
+            staging.push_back(std::move(texture));
+        }
+        decoded.clear();
+    }
+    if (staging.empty()) {
+        return;
+    }
+    createRing();
+
+    size_t stagedBytes = 0;
+    size_t staged = 0;
+    for (; staged < staging.size(); staged++) {
+        DecodedTexture &texture = staging[staged];
+        if (texture.levels().empty()) {
+            pendingTextures--; // Could not be decoded, keeps its placeholder
+            continue;
+        }
+
+        int firstLevel = 0;
+        TextureArray *array = texture.target.array;
+        if (array != nullptr) {
+            firstLevel = reserveTextureArrayLayer(*array, texture.format(), texture.levels(), texture.target.layer);
+            if (firstLevel < 0) {
+                pendingTextures--; // Does not fit the array, the layer stays as it is
+                continue;
+            }
+        }
+        size_t begin = uploadedOffset(texture, firstLevel);
+        size_t size = texture.size() - begin;
+        if (stagedBytes > 0 && stagedBytes + size > textureUploadBytesPerFrame) {
+            break;
+        }
+
+        if (size > textureStagingBytes) {
+            // Too large for the ring, the driver copies it out of memory instead
+            GLuint handle = array != nullptr ? 0 : createTexture(texture);
+            uploadLevels(handle, firstLevel, texture, texture.data() + begin);
+            makeResident(texture.target, handle);
+            pendingTextures--;
+            stagedBytes += size;
+        } else {
+            size_t offset = allocateStaging(size);
+            if (offset == noRoom) {
+                break;
+            }
+            std::memcpy(ringMapping + offset, texture.data() + begin, size);
+            ringHead = (offset + size + stagingAlignment - 1) / stagingAlignment * stagingAlignment;
+
+            GLuint handle = array != nullptr ? 0 : createTexture(texture);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ringBuffer);
+            uploadLevels(handle, firstLevel, texture, reinterpret_cast<const unsigned char *>(offset));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            inFlight.push_back({ texture.target, handle, offset, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), true });
+            stagedBytes += size;
+        }
+
+        if (array != nullptr) {
+            retainLayer(texture, firstLevel);
+        } else {
+            standaloneTextureBytes += texture.size();
+        }
+    }
+    staging.erase(staging.begin(), staging.begin() + staged);
+}
+
+// Unused arrays come last
+static float residencyPriority(const ArrayResidency &residency) {
+    return residency.unusedFrames >= textureUnusedFrames ? -1.0f : residency.footprint;
+}
+
+// The finest level worth keeping: the coarsest level that is still at least
+// as large as the array appears on screen. Textures that repeat across a
+// node need less, so this never blurs them.
+static unsigned int wantedLevel(const ArrayResidency &residency) {
+    const TextureArray &array = *residency.array;
+    unsigned int coarsest = firstResidentLevel(array);
+    if (residency.unusedFrames >= textureUnusedFrames) {
+        return coarsest;
+    }
+    unsigned int level = 0;
+    while (level < coarsest && float(std::max(array.width, array.height) >> (level + 1)) >= residency.footprint) {
+        level++;
+    }
+    return level;
+}
+
+// The least visible array below the given priority that can give up a level
+static ArrayResidency *evictionCandidate(const ArrayResidency *except, float below) {
+    ArrayResidency *candidate = nullptr;
+    for (ArrayResidency &residency : residencies) {
+        const TextureArray &array = *residency.array;
+        if (&residency == except || array.texture == 0 || array.residentLevel >= firstResidentLevel(array)
+            || residencyPriority(residency) >= below) {
+            continue;
+        }
+        if (candidate == nullptr || residencyPriority(residency) < residencyPriority(*candidate)) {
+            candidate = &residency;
+        }
+    }
+    return candidate;
+}
+
+// Drops the finest level of the array, returning the bytes freed
+static size_t demote(ArrayResidency &residency) {
+    TextureArray &array = *residency.array;
+    size_t before = textureArrayBytes(array, array.residentLevel);
+    setTextureArrayResidentLevel(array, array.residentLevel + 1);
+    return before - textureArrayBytes(array, array.residentLevel);
+}
+
+// Adds the next finer level to the array and uploads it for every layer that
+// was loaded. When the ring is full, waits for the oldest uploads to finish if
+// asked to, otherwise returns false to try again in a later frame. Levels too
+// large for the ring are uploaded from memory.
+static bool promote(ArrayResidency &residency, bool wait) {
+    TextureArray &array = *residency.array;
+    unsigned int level = array.residentLevel - 1;
+    size_t total = 0;
+    for (size_t layer = 0; layer < residency.layers.size(); layer++) {
+        if (residency.layers[layer] != nullptr) {
+            total += residency.layers[layer]->levels()[residency.firstLevels[layer] + level].size;
+        }
+    }
+
+    createRing();
+    bool fitsRing = total > 0 && total <= textureStagingBytes;
+    size_t offset = fitsRing ? allocateStaging(total) : noRoom;
+    if (offset == noRoom && fitsRing) {
+        if (!wait) {
+            return false;
+        }
+        // The ring always has room once nothing is in flight
+        while (offset == noRoom) {
+            glClientWaitSync(inFlight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            retireUploads();
+            offset = allocateStaging(total);
+        }
+    }
+
+    setTextureArrayResidentLevel(array, level);
+    if (offset != noRoom) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ringBuffer);
+    }
+    size_t cursor = offset;
+    for (size_t layer = 0; layer < residency.layers.size(); layer++) {
+        const DecodedTexture *texture = residency.layers[layer].get();
+        if (texture == nullptr) {
+            continue;
+        }
+        int firstLevel = residency.firstLevels[layer];
+        const TextureLevel &data = texture->levels()[firstLevel + level];
+        const unsigned char *source = texture->data() + data.offset;
+        if (offset != noRoom) {
+            std::memcpy(ringMapping + cursor, source, data.size);
+            source = reinterpret_cast<const unsigned char *>(cursor);
+            cursor += data.size;
+        }
+        uploadTextureArrayLevels(array, (unsigned int) layer, level, level + 1, texture->levels(), firstLevel, source);
+    }
+    if (offset != noRoom) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ringHead = (offset + total + stagingAlignment - 1) / stagingAlignment * stagingAlignment;
+        inFlight.push_back({ { nullptr, nullptr, 0, nullptr }, 0, offset, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), false });
+    }
+    return true;
+}
+
+// Promotes the most visible array that lacks detail it needs by one level,
+// evicting the finest levels of less visible arrays to stay within the
+// budget. Returns whether an array was promoted.
+static bool updateResidency(bool waitForRing) {
+    size_t used = textureMemoryUsed();
+
+    ArrayResidency *next = nullptr;
+    for (ArrayResidency &residency : residencies) {
+        if (residency.array->texture != 0 && residency.array->residentLevel > wantedLevel(residency)
+            && (next == nullptr || residencyPriority(residency) > residencyPriority(*next))) {
+            next = &residency;
+        }
+    }
+
+    bool promoted = false;
+    if (next != nullptr) {
+        const TextureArray &array = *next->array;
+        size_t extra = textureArrayBytes(array, array.residentLevel - 1) - textureArrayBytes(array, array.residentLevel);
+        while (used + extra > textureBudget) {
+            ArrayResidency *victim = evictionCandidate(next, residencyPriority(*next));
+            if (victim == nullptr) {
+                break;
+            }
+            used -= demote(*victim);
+        }
+        if (used + extra <= textureBudget && promote(*next, waitForRing)) {
+            promoted = true;
+            used += extra;
+        }
+    }
+
+    // Still over the budget, for instance after it was lowered
+    while (used > textureBudget) {
+        ArrayResidency *victim = evictionCandidate(nullptr, INFINITY);
+        if (victim == nullptr) {
+            break;
+        }
+        used -= demote(*victim);
+    }
+
+    for (ArrayResidency &residency : residencies) {
+        residency.unusedFrames = residency.reported ? 0 : residency.unusedFrames + 1;
+        residency.reported = false;
+    }
+    return promoted;
+}
+
+static void requestTexture(const ChannelSource channels[4], TextureKind kind, TextureTarget target) {
+    pendingTextures++;
+    if (!s3tcChecked) {
+        s3tcSupported = hasExtension("GL_EXT_texture_compression_s3tc");
+        s3tcChecked = true;
+    }
+
+    TextureRequest request = { { channels[0], channels[1], channels[2], channels[3] }, kind, s3tcSupported, std::move(target) };
+    std::lock_guard<std::mutex> lock(loaderMutex);
+    if (!loaderThread.joinable()) {
+        loaderThread = std::thread(loaderLoop);
+    }
+    requests.push_back(std::move(request));
+    requestsArrived.notify_one();
+}
+
+void streamTexture(const std::string &fileName, GLuint *textureID, glm::vec4 placeholder, TextureKind kind) {
+    *textureID = placeholderTexture(placeholder);
+    const ChannelSource channels[4] = { { fileName, 0, 0 }, { fileName, 1, 0 }, { fileName, 2, 0 }, { fileName, 3, 0 } };
+    requestTexture(channels, kind, { textureID, nullptr, 0, nullptr });
+}
+
+void streamTextureLayer(const ChannelSource channels[4], TextureKind kind, TextureArray *array, unsigned int layer,
+                        std::function<void()> resident) {
+    requestTexture(channels, kind, { nullptr, array, layer, std::move(resident) });
+}
+
+void updateTextureStreaming() {
+    if (pendingTextures > 0 || !inFlight.empty()) {
+        retireUploads();
+        stageDecoded();
+    }
+    updateResidency(false);
+}
+
+size_t pendingTextureCount() {
+    return pendingTextures;
+}
+
+bool textureStreamingIdle() {
+    return pendingTextures == 0 && staging.empty() && inFlight.empty();
+}
+
+void finishTextureStreaming() {
+    while (true) {
+        updateTextureStreaming();
+        if (pendingTextures == 0) {
+            break;
+        }
+        if (!inFlight.empty()) {
+            glClientWaitSync(inFlight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } else if (staging.empty()) {
+            std::unique_lock<std::mutex> lock(loaderMutex);
+            decodedArrived.wait(lock, [] { return !decoded.empty(); });
+        }
+    }
+
+    // Then brings every array to full detail, as far as the budget allows,
+    // so that what is drawn next does not depend on how many frames came before
+    do {
+        for (ArrayResidency &residency : residencies) {
+            residency.footprint = INFINITY;
+            residency.reported = true;
+            residency.unusedFrames = 0;
+        }
+    } while (updateResidency(true));
+}
+
+void reportTextureFootprint(const TextureArray *array, float pixels) {
+    for (ArrayResidency &residency : residencies) {
+        if (residency.array == array) {
+            residency.footprint = residency.reported ? std::max(residency.footprint, pixels) : pixels;
+            residency.reported = true;
+            return;
+        }
+    }
+}
+
+void setTextureMemoryBudget(size_t bytes) {
+    textureBudget = bytes;
+}
+
+size_t textureMemoryUsed() {
+    size_t used = standaloneTextureBytes;
+    for (const ArrayResidency &residency : residencies) {
+        used += textureArrayBytes(*residency.array, residency.array->residentLevel);
+    }
+    return used;
+}
+
+void setTextureCacheDirectory(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(loaderMutex);
+    cacheDirectory = directory;
+}
+
+void releaseTextureStreaming() {
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loaderStopping = true;
+    }
+    requestsArrived.notify_all();
+    if (loaderThread.joinable()) {
+        loaderThread.join();
+    }
+    loaderStopping = false;
+    requests.clear();
+    decoded.clear();
+    staging.clear();
+
+    for (const InFlightUpload &upload : inFlight) {
+        glDeleteSync(upload.fence);
+        if (upload.texture != 0) {
+            glDeleteTextures(1, &upload.texture);
+        }
+    }
+    inFlight.clear();
+    for (const Placeholder &placeholder : placeholders) {
+        glDeleteTextures(1, &placeholder.texture);
+    }
+    placeholders.clear();
+
+    releaseBuffer(ringBuffer);
+    ringBuffer = 0;
+    ringMapping = nullptr;
+    ringHead = 0;
+    pendingTextures = 0;
+    residencies.clear();
+    standaloneTextureBytes = 0;
+    s3tcChecked = false;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "textureArray.h"
+#include "textureCompression.h"
+
+// Loads textures without stalling frames. Files are decoded and block
+// compressed with their mip chain on a loader thread, or, when the texture
+// cache has them, mapped from there without decoding. Each frame,
+// updateTextureStreaming() copies encoded textures into a persistently mapped
+// pixel buffer ring and issues the uploads of their levels from there, so the
+// driver copies them to the GPU asynchronously. A fence after each upload
+// tells when the texture can replace its placeholder, and when its part of the
+// ring can be reused.
+
+// Size of the staging ring. Larger images are uploaded straight from memory.
+const size_t textureStagingBytes = 32 * 1024 * 1024;
+
+// Bytes staged per frame, to spread the copies of a burst of textures over
+// several frames. At least one image is staged every frame.
+const size_t textureUploadBytesPerFrame = 8 * 1024 * 1024;
+
+// Starts loading a PNG file into a mipmapped texture in the format that suits
+// kind, see encodeTexture(). *textureID is set to a 1x1 texture of the
+// placeholder colour right away, and to the texture once it is resident, so
+// it must stay valid until then. It keeps the placeholder if the file cannot
+// be decoded.
+void streamTexture(const std::string &fileName, GLuint *textureID, glm::vec4 placeholder, TextureKind kind);
+
+// One channel of a texture packed from several files
+struct ChannelSource {
+    // The PNG file, or empty for the constant
+    std::string fileName;
+    // Which channel of the file, 0 to 3
+    int channel;
+    // Also used if the file cannot be decoded, or is not the size of the others
+    unsigned char constant;
+};
+
+// Starts loading a texture whose channels come from the given files into a
+// layer of the array, see reserveTextureArrayLayer(). resident is called on
+// the GL thread once the layer can be sampled, and never if none of the files
+// can be decoded or the texture does not fit the array. The array must stay
+// valid until then.
+void streamTextureLayer(const ChannelSource channels[4], TextureKind kind, TextureArray *array, unsigned int layer,
+                        std::function<void()> resident);
+
+// Memory that streamed textures may take on the GPU, unless set otherwise
+const size_t defaultTextureMemoryBudget = 256 * 1024 * 1024;
+
+// Texture arrays that were not on screen for this many frames are the first
+// to give up their finest levels
+const unsigned int textureUnusedFrames = 120;
+
+// Swaps in textures whose uploads finished, stages newly decoded ones and
+// adjusts the detail of texture arrays. Call once per frame, on the thread
+// that owns the GL context.
+//
+// Texture arrays are first loaded with their small levels only, see
+// textureArrayFirstSize. Every frame, the array that appears largest on
+// screen among those showing less detail than their footprint calls for gets
+// its next finer level, if that fits into the budget. The finest levels of
+// unused or less visible arrays are evicted to make room. The levels of every
+// loaded layer stay in memory, so evicted levels can be uploaded again.
+void updateTextureStreaming();
+
+// Reports how many pixels across something drawn with the array covers this
+// frame. The largest report of a frame counts.
+void reportTextureFootprint(const TextureArray *array, float pixels);
+
+void setTextureMemoryBudget(size_t bytes);
+
+// Bytes of GPU memory the streamed textures take
+size_t textureMemoryUsed();
+
+// Number of textures that still show their placeholder
+size_t pendingTextureCount();
+
+// True once every requested texture is resident and no upload is in flight.
+// From then on streaming makes no heap allocations, as promoting and evicting
+// levels only reuses the ring and its reserved list of uploads.
+bool textureStreamingIdle();
+
+// Blocks until every requested texture is resident, and every texture array
+// has all its levels that fit into the budget. Finer levels go through the
+// ring like all other uploads, waiting for earlier uploads to free it.
+void finishTextureStreaming();
+
+// Where encoded textures are cached, ../res/cache/textures by default. An
+// empty string disables the cache.
+void setTextureCacheDirectory(const std::string &directory);
+
+// Stops the loader thread and deletes the staging ring and the placeholders.
+// Textures that were swapped in belong to their users.
+void releaseTextureStreaming();
@@ -0,0 +1,93 @@
+#include "threadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int workerCount) {
+    mWorkers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; i++) {
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWorkAvailable.notify_all();
+    for (std::thread &worker : mWorkers) {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::runChunk(Batch &batch, std::unique_lock<std::mutex> &lock) {
+    size_t chunk = batch.nextChunk++;
+    if (batch.nextChunk == batch.chunkCount) {
+        // Nothing left to hand out, so take the batch off the list
+        Batch **link = &mBatches;
+        while (*link != &batch) {
+            link = &(*link)->next;
+        }
+        *link = batch.next;
+    }
+
+    lock.unlock();
+    size_t begin = chunk * batch.chunkSize;
+    batch.body(begin, std::min(batch.count, begin + batch.chunkSize));
+    lock.lock();
+
+    // Notified with the lock held, so the caller cannot return and destroy
+    // the batch before this thread is done with it
+    if (--batch.unfinishedChunks == 0) {
+        batch.finished.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWorkAvailable.wait(lock, [this]() { return mStopping || mBatches != nullptr; });
+        if (mBatches == nullptr) {
+            return;
+        }
+        runChunk(*mBatches, lock);
+    }
+}
+
+void ThreadPool::runParallelFor(size_t count, size_t minChunkSize, ChunkBody body) {
+    if (count == 0) {
+        return;
+    }
+
+    // A few chunks per thread evens out chunks that take longer than others
+    size_t chunkCount = std::min(count / std::max<size_t>(minChunkSize, 1), size_t(4) * threadCount());
+    if (chunkCount <= 1 || mWorkers.empty()) {
+        body(0, count);
+        return;
+    }
+
+    Batch batch;
+    batch.body = body;
+    batch.count = count;
+    batch.chunkSize = (count + chunkCount - 1) / chunkCount;
+    batch.chunkCount = (count + batch.chunkSize - 1) / batch.chunkSize;
+    batch.nextChunk = 0;
+    batch.unfinishedChunks = batch.chunkCount;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    batch.next = mBatches;
+    mBatches = &batch;
+    mWorkAvailable.notify_all();
+
+    // Work on the batch too instead of idling. This also keeps nested calls
+    // from waiting on chunks that no free thread is left to run.
+    while (batch.nextChunk < batch.chunkCount) {
+        runChunk(batch, lock);
+    }
+    batch.finished.wait(lock, [&]() { return batch.unfinishedChunks == 0; });
+}
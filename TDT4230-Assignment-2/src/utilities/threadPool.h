@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for splitting CPU work such as mesh and image
+// processing. The calling thread takes part in the work, so a pool with zero
+// workers runs everything on the caller.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Threads that run work, including the caller
+    unsigned int threadCount() const { return (unsigned int) mWorkers.size() + 1; }
+
+    // Calls body(begin, end) for ranges that together cover [0, count), each at
+    // least minChunkSize long where possible, and returns when all have finished.
+    // May be called from inside a body. Does not allocate, as the body is only
+    // referred to, never copied into a std::function.
+    template <typename Body>
+    void parallelFor(size_t count, size_t minChunkSize, const Body &body) {
+        runParallelFor(count, minChunkSize, ChunkBody{ &body, [](const void *function, size_t begin, size_t end) {
+            (*static_cast<const Body *>(function))(begin, end);
+        } });
+    }
+
+    // One worker per hardware thread besides the caller's
+    static ThreadPool &shared();
+
+private:
+    // Calls the body of a parallelFor() call, which lives on the caller's stack
+    struct ChunkBody {
+        const void *function;
+        void (*call)(const void *function, size_t begin, size_t end);
+
+        void operator()(size_t begin, size_t end) const { call(function, begin, end); }
+    };
+
+    // The chunks of one parallelFor() call. Lives on the caller's stack.
+    struct Batch {
+        ChunkBody body;
+        size_t count;
+        size_t chunkSize;
+        size_t chunkCount;
+        size_t nextChunk;
+        size_t unfinishedChunks;
+        std::condition_variable finished;
+        Batch *next;
+    };
+
+    void runParallelFor(size_t count, size_t minChunkSize, ChunkBody body);
+    void workerLoop();
+    // Runs the next chunk of the batch with mMutex held by lock, unlocking it meanwhile
+    void runChunk(Batch &batch, std::unique_lock<std::mutex> &lock);
+
+    std::vector<std::thread> mWorkers;
+    // Batches with chunks nobody has started yet, newest first
+    Batch *mBatches = nullptr;
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    bool mStopping = false;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// Compile-time descriptions of interleaved vertex formats. A layout lists its
+// attributes, and from that list it provides a packed vertex type without padding
+// and the attribute format calls that describe the vertex to a VAO.
+
+namespace vertexFormat {
+
+// Each format says how one attribute is stored and how GL reads it back
+
+struct Float3 {
+    typedef glm::vec3 Storage;
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static Storage pack(glm::vec3 value) { return value; }
+};
+
+// Two half floats. UVs in [-2, 2] keep a precision of 1/1024 or better,
+// so heavily tiled textures should use Float2 instead.
+struct Half2 {
+    typedef std::uint32_t Storage;
+    static constexpr GLint components = 2;
+    static constexpr GLenum type = GL_HALF_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static Storage pack(glm::vec2 value) { return glm::packHalf2x16(value); }
+};
+
+struct Float2 {
+    typedef glm::vec2 Storage;
+    static constexpr GLint components = 2;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static Storage pack(glm::vec2 value) { return value; }
+};
+
+// A unit vector as three signed normalised 10 bit components. The 2 bit w is unused.
+struct Snorm10_10_10_2 {
+    typedef std::uint32_t Storage;
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static Storage pack(glm::vec3 value) { return glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(value), 0)); }
+};
+
+// A tangent frame as a unit quaternion (x, y, z, w) in signed normalised 16 bit
+// components. The sign of w carries the handedness of the frame, see
+// tangentFrameQuaternion() in glutils.h.
+struct QTangent {
+    struct Storage {
+        std::int16_t x, y, z, w;
+    };
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_SHORT;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static Storage pack(glm::vec4 quaternion) {
+        glm::vec4 scaled = glm::round(glm::clamp(quaternion, -1.0f, 1.0f) * 32767.0f);
+        return { std::int16_t(scaled.x), std::int16_t(scaled.y), std::int16_t(scaled.z), std::int16_t(scaled.w) };
+    }
+};
+
+}
+
+// An attribute of a layout, read by the shader input at the given location
+template <GLuint Location, class Format>
+struct VertexAttribute {
+    static constexpr GLuint location = Location;
+    typedef Format format;
+    static constexpr GLsizei size = sizeof(typename Format::Storage);
+};
+
+template <class... Attributes>
+struct VertexLayout {
+    template <size_t Index>
+    using AttributeAt = typename std::tuple_element<Index, std::tuple<Attributes...>>::type;
+
+    static constexpr GLsizei stride = (Attributes::size + ...);
+
+    // Byte offset of the attribute at the given index within a vertex
+    template <size_t Index>
+    static constexpr GLsizei offset() {
+        constexpr GLsizei sizes[] = { Attributes::size... };
+        GLsizei result = 0;
+        for (size_t i = 0; i < Index; i++) {
+            result += sizes[i];
+        }
+        return result;
+    }
+
+    // One interleaved vertex. Attributes are written through set<Index>(),
+    // which packs the value with the attribute's format.
+    struct Vertex {
+        unsigned char bytes[stride];
+
+        template <size_t Index, class Value>
+        void set(const Value &value) {
+            typename AttributeAt<Index>::format::Storage packed = AttributeAt<Index>::format::pack(value);
+            std::memcpy(bytes + offset<Index>(), &packed, sizeof(packed));
+        }
+    };
+
+    static_assert(sizeof(Vertex) == stride, "Vertices must be tightly packed");
+
+    // Describes the layout to a VAO, reading the vertices from the buffer
+    // attached to the given binding index
+    static void setupAttributes(GLuint vertexArray, GLuint bindingIndex) {
+        setupAttributes(vertexArray, bindingIndex, std::index_sequence_for<Attributes...>());
+    }
+
+private:
+    template <size_t... Indices>
+    static void setupAttributes(GLuint vertexArray, GLuint bindingIndex, std::index_sequence<Indices...>) {
+        (setupAttribute<Indices>(vertexArray, bindingIndex), ...);
+    }
+
+    template <size_t Index>
+    static void setupAttribute(GLuint vertexArray, GLuint bindingIndex) {
+        typedef AttributeAt<Index> Attribute;
+        glVertexArrayAttribFormat(vertexArray, Attribute::location, Attribute::format::components,
+                                  Attribute::format::type, Attribute::format::normalized, offset<Index>());
+        glVertexArrayAttribBinding(vertexArray, Attribute::location, bindingIndex);
+        glEnableVertexArrayAttrib(vertexArray, Attribute::location);
+    }
+};
+
+// Geometry lit by simple.vert: 28 bytes per vertex in a single stream
+typedef VertexLayout<VertexAttribute<0, vertexFormat::Float3>,           // position
+                     VertexAttribute<1, vertexFormat::Snorm10_10_10_2>,  // normal
+                     VertexAttribute<2, vertexFormat::Half2>,            // texture coordinates
+                     VertexAttribute<3, vertexFormat::QTangent>>         // tangent frame
+        LitVertexLayout;
+enum LitVertexAttribute { LIT_POSITION, LIT_NORMAL, LIT_TEXTURE_COORDINATES, LIT_TANGENT_FRAME };
+static_assert(LitVertexLayout::stride == 28, "Unexpected lit vertex size");
+
+// Unlit, textured geometry such as the text drawn by 2d.vert: 16 bytes per vertex
+typedef VertexLayout<VertexAttribute<0, vertexFormat::Float3>,           // position
+                     VertexAttribute<2, vertexFormat::Half2>>            // texture coordinates
+        UnlitVertexLayout;
+enum UnlitVertexAttribute { UNLIT_POSITION, UNLIT_TEXTURE_COORDINATES };
+static_assert(UnlitVertexLayout::stride == 16, "Unexpected unlit vertex size");
@@ -16,4 +16,13 @@ const int         windowSamples   = 4;
 struct CommandLineOptions {
     bool enableMusic;
     bool enableAutoplay;
+    bool enforceZeroAllocations;
+    int benchmarkFrames;
+    std::string benchmarkOutput;
+    bool goldenCheck;
+    bool goldenUpdate;
+    bool sphereImpostors;
+    int textureBudgetMiB;
+    bool ballShadow;
+    bool programCache;
 };
\ No newline at end of file
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+Records performance baselines and compares new runs against them.
+
+Both the in-game benchmark mode (glowbox --benchmark) and the micro-benchmarks
+(glowbox_bench) are run several times. Every metric then has one sample per run.
+A metric counts as a regression when its mean got worse by more than the
+metric's threshold and the 95% confidence interval of the change lies entirely
+on the worse side, so run-to-run noise alone does not fail a comparison.
+
+    tools/perfcompare.py record  --build-dir build --baseline perf/baseline.json
+    tools/perfcompare.py compare --build-dir build --baseline perf/baseline.json
+
+Timings only compare meaningfully on the same machine and build configuration.
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+# Two-sided 95% critical values of Student's t distribution, by degrees of freedom
+T_95 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+# Allowed relative slowdown per metric before it counts as a regression.
+# Matched against the start of the metric name, the longest match wins.
+DEFAULT_THRESHOLDS = {
+    "game.frame_time_ms": 0.05,
+    "game.shader_setup_ms": 0.25,
+    "game.gl_per_frame": 0.0,
+    "game.allocations_per_frame": 0.0,
+    "bench.": 0.10,
+}
+
+# Metrics that are deterministic, so any increase at all is a regression
+EXACT_SUFFIXES = (".allocations", ".allocated_bytes")
+
+
+def t_critical(degrees_of_freedom):
+    if degrees_of_freedom < 1:
+        return float("inf")
+    index = int(math.floor(degrees_of_freedom)) - 1
+    return T_95[index] if index < len(T_95) else 1.960
+
+
+def mean(samples):
+    return sum(samples) / len(samples)
+
+
+def variance(samples):
+    if len(samples) < 2:
+        return 0.0
+    m = mean(samples)
+    return sum((x - m) ** 2 for x in samples) / (len(samples) - 1)
+
+
+def confidence_interval(samples):
+    """Half-width of the 95% confidence interval of the mean"""
+    if len(samples) < 2:
+        return 0.0
+    return t_critical(len(samples) - 1) * math.sqrt(variance(samples) / len(samples))
+
+
+def difference_interval(baseline, current):
+    """95% confidence interval of mean(current) - mean(baseline), using Welch's t-test"""
+    difference = mean(current) - mean(baseline)
+    a = variance(baseline) / len(baseline)
+    b = variance(current) / len(current)
+    if a + b == 0:
+        return difference, difference
+    # Welch-Satterthwaite degrees of freedom
+    denominator = 0.0
+    if len(baseline) > 1:
+        denominator += a ** 2 / (len(baseline) - 1)
+    if len(current) > 1:
+        denominator += b ** 2 / (len(current) - 1)
+    half_width = t_critical((a + b) ** 2 / denominator) * math.sqrt(a + b)
+    return difference - half_width, difference + half_width
+
+
+def higher_is_better(metric):
+    return metric.endswith("_per_second")
+
+
+def threshold_for(metric, overrides):
+    table = dict(DEFAULT_THRESHOLDS)
+    table.update(overrides)
+    matches = [prefix for prefix in table if metric.startswith(prefix)]
+    return table[max(matches, key=len)] if matches else 0.05
+
+
+def flatten(prefix, value, out):
+    if isinstance(value, dict):
+        for key, child in value.items():
+            flatten(prefix + "." + key, child, out)
+    elif isinstance(value, (int, float)) and not isinstance(value, bool):
+        out[prefix] = float(value)
+
+
+def game_metrics(report):
+    metrics = {}
+    for section in ("frame_time_ms", "gl_per_frame", "allocations_per_frame"):
+        if section in report:
+            flatten("game." + section, report[section], metrics)
+    if "shader_setup_ms" in report:
+        metrics["game.shader_setup_ms"] = float(report["shader_setup_ms"])
+    # The spread within a run is not something we want to compare between runs
+    metrics.pop("game.frame_time_ms.stddev", None)
+    return metrics
+
+
+def bench_metrics(report):
+    metrics = {}
+    for result in report["benchmarks"]:
+        name = "bench." + result["name"]
+        for key, value in result.items():
+            if key in ("median_ns", "allocations", "allocated_bytes", "peak_bytes") or key.endswith("_per_second"):
+                metrics[name + "." + key] = float(value)
+    return metrics
+
+
+def run_json(command, output_flag, build_dir):
+    with tempfile.TemporaryDirectory() as scratch:
+        output = os.path.join(scratch, "report.json")
+        subprocess.run(command + [output_flag, output], cwd=build_dir, check=True,
+                       stdout=subprocess.DEVNULL)
+        with open(output) as f:
+            return json.load(f)
+
+
+def collect(args):
+    """Runs everything args.runs times and returns {metric: [sample per run]}"""
+    samples = {}
+    for run in range(args.runs):
+        print(f"Run {run + 1}/{args.runs}", file=sys.stderr)
+        metrics = {}
+        if not args.skip_game:
+            report = run_json(["./glowbox", "--benchmark", str(args.frames)], "--benchmark-output", args.build_dir)
+            metrics.update(game_metrics(report))
+        if not args.skip_bench:
+            command = ["./glowbox_bench"]
+            if args.filter:
+                command += ["--filter", args.filter]
+            report = run_json(command, "--output", args.build_dir)
+            metrics.update(bench_metrics(report))
+        for metric, value in metrics.items():
+            samples.setdefault(metric, []).append(value)
+    return samples
+
+
+def record(args):
+    samples = collect(args)
+    directory = os.path.dirname(args.baseline)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+    with open(args.baseline, "w") as f:
+        json.dump({"runs": args.runs, "frames": args.frames, "metrics": samples}, f, indent=4, sort_keys=True)
+    print(f"Recorded {len(samples)} metrics over {args.runs} runs to {args.baseline}")
+    return 0
+
+
+def compare(args):
+    with open(args.baseline) as f:
+        baseline = json.load(f)["metrics"]
+    current = collect(args)
+
+    overrides = {}
+    for item in args.threshold:
+        prefix, _, value = item.partition("=")
+        overrides[prefix] = float(value) / 100.0
+
+    regressions = []
+    print(f"{'metric':<72} {'baseline':>14} {'current':>22} {'change':>9}")
+    for metric in sorted(set(baseline) & set(current)):
+        old, new = baseline[metric], current[metric]
+        old_mean, new_mean = mean(old), mean(new)
+        low, high = difference_interval(old, new)
+        sign = -1.0 if higher_is_better(metric) else 1.0
+        relative = (new_mean - old_mean) / abs(old_mean) if old_mean != 0 else (0.0 if new_mean == old_mean else math.inf)
+
+        if metric.endswith(EXACT_SUFFIXES):
+            regressed = sign * (new_mean - old_mean) > 0
+        else:
+            threshold = threshold_for(metric, overrides)
+            # Worse by more than the threshold, and significantly worse at all
+            significantly_worse = (low > 0) if sign > 0 else (high < 0)
+            regressed = sign * relative > threshold and significantly_worse
+
+        flag = "  REGRESSION" if regressed else ""
+        print(f"{metric:<72} {old_mean:>14.4g} {new_mean:>12.4g} ±{confidence_interval(new):<9.2g}"
+              f"{100 * relative:>+8.1f}%{flag}")
+        if regressed:
+            regressions.append(metric)
+
+    for metric in sorted(set(baseline) - set(current)):
+        print(f"{metric:<72} missing from the current run")
+
+    if regressions:
+        print(f"\n{len(regressions)} metric(s) regressed beyond their threshold")
+        return 1
+    print("\nNo regressions")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("mode", choices=["record", "compare"])
+    parser.add_argument("--build-dir", default="build", help="Directory containing glowbox and glowbox_bench")
+    parser.add_argument("--baseline", default="perf/baseline.json", help="Baseline file to write or compare against")
+    parser.add_argument("--runs", type=int, default=5, help="Repetitions of every benchmark")
+    parser.add_argument("--frames", type=int, default=1000, help="Frames per game benchmark run")
+    parser.add_argument("--filter", default="", help="Only run micro-benchmarks whose name contains this")
+    parser.add_argument("--skip-game", action="store_true", help="Do not run the game benchmark, which needs a display")
+    parser.add_argument("--skip-bench", action="store_true", help="Do not run the micro-benchmarks")
+    parser.add_argument("--threshold", action="append", default=[], metavar="PREFIX=PERCENT",
+                        help="Override the allowed slowdown for metrics starting with PREFIX")
+    args = parser.parse_args()
+
+    args.baseline = os.path.abspath(args.baseline)
+    if args.runs < 2:
+        parser.error("at least two runs are needed for confidence intervals")
+    return record(args) if args.mode == "record" else compare(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())